@@ -1,6 +1,8 @@
 #include "HttpServer.h"
 #include "SolarPowerMgrApp.h"
 #include "automation/device/PowerSwitch.h"
+#include "xmonit/ActuatorMetrics.h"
+#include "automation/constraint/EvaluationContext.h"
 #include "Poco/Mutex.h"
 #include "Poco/StringTokenizer.h"
 #include "Poco/JSON/Query.h"
@@ -8,10 +10,15 @@
 #include "Poco/URI.h"
 #include <Poco/RegularExpression.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace xmonit
 {
   const Poco::RegularExpression SINGLE_FIELD_QUERY_RE("^(on|constraint[.]enabled)$", Poco::RegularExpression::RE_CASELESS, true);
 
+  const int MAX_WHATIF_EVALUATIONS = 2000;
+
   HTTPRequestHandler *RequestHandlerFactory::createRequestHandler(const HTTPServerRequest &)
   {
     DefaultRequestHandler *pReqHandler = new DefaultRequestHandler(mutex, allowedIpAddresses);
@@ -86,7 +93,7 @@ namespace xmonit
       } else {  
         if ( vecPath.empty() ) {
 
-          std::string strMsg("Rest endpoint required (device, constraint, sensor, capability, or app): ");
+          std::string strMsg("Rest endpoint required (device, constraint, sensor, capability, whatif, actuator, or app): ");
           strMsg += req.getURI();
           cerr << __PRETTY_FUNCTION__ << strMsg << endl;
           writeJsonResp( out, -8, strMsg );
@@ -162,7 +169,7 @@ namespace xmonit
                   const string& field = fields[0];
 
                   if ( field == "on" ) {
-                    out << pSwitch->isOn();
+                    out << pSwitch->isOnObserved();
                   } else if ( field == "constraint.enabled" ) {
                     Constraint* pConstraint = pSwitch->getConstraint();
                     out << (pConstraint && pConstraint->bEnabled);
@@ -243,6 +250,7 @@ namespace xmonit
               cout << "Setting " << itemType << " '" << pItem->getTitle() << "' " << strKey << "=" << strVal << endl;
               stringstream ss;
               automation::SetCode statusCode = pItem->setAttribute(strKey.c_str(), strVal.c_str(), &ss);
+              SolarPowerMgrApp::pInstance->flushPendingCommands(); // constraint and capability changes toggle switches too
               if ( !respMsg.empty() ) {
                 respMsg += " | ";
               }
@@ -275,6 +283,34 @@ namespace xmonit
             out << "Invalid " << itemType << " http METHOD: '" << strMethod << "'. URI: " << req.getURI() << endl;
             cerr << __PRETTY_FUNCTION__ << " Invalid " << itemType << " METHOD: '" << strMethod << "'. URI: " << req.getURI() << endl;
           }          
+        } else if ( vecPath[0] == "whatif" ) {
+          if ( pReqObj ) {
+            handleWhatIf(out, pReqObj);
+          } else {
+            respStatus = HTTPResponse::HTTP_BAD_REQUEST;
+            writeJsonResp(out, -4, "whatif requires a PUT or POST with a JSON body");
+          }
+        } else if ( vecPath[0] == "actuator" && strMethod == "get" ) {
+          // switch command latency percentiles (milliseconds) and result counts by device
+          Poco::JSON::Array actuatorArr;
+          for ( const xmonit::ActuatorMetrics::Snapshot& snapshot : xmonit::ActuatorMetrics::instance.getSnapshots() ) {
+            Poco::JSON::Object actuatorObj(true);
+            actuatorObj.set("name", snapshot.name);
+            actuatorObj.set("count", (Poco::UInt64) snapshot.count);
+            actuatorObj.set("p50Ms", snapshot.p50Us / 1000.0);
+            actuatorObj.set("p95Ms", snapshot.p95Us / 1000.0);
+            actuatorObj.set("p99Ms", snapshot.p99Us / 1000.0);
+            actuatorObj.set("maxMs", snapshot.maxUs / 1000.0);
+            Poco::JSON::Object resultsObj(true);
+            for ( int i = 0; i < xmonit::ActuatorMetrics::RESULT_CNT; i++ ) {
+              resultsObj.set(xmonit::ActuatorMetrics::getResultName((xmonit::ActuatorMetrics::Result)i), (Poco::UInt64) snapshot.resultCnts[i]);
+            }
+            actuatorObj.set("results", resultsObj);
+            actuatorArr.add(actuatorObj);
+          }
+          Poco::JSON::Object respObj(true);
+          respObj.set("actuators", actuatorArr);
+          writeJsonResp(out, 0, "OK", respObj);
         } else if ( vecPath[0] == "app" ) {    
           if ( strMethod == "get" ) {
             if ( fields.empty() || fields.size() == 1 && Poco::toLower(fields[0]) == "enabled" ) {
@@ -333,6 +369,165 @@ namespace xmonit
   }
 
 
+  static Poco::JSON::Object::Ptr evaluationToJson(const EvaluationContext& ctx, const Constraint* pConstraint) {
+    Poco::JSON::Object::Ptr pObj = new Poco::JSON::Object(true);
+    pObj->set("id", (int) pConstraint->id);
+    pObj->set("title", pConstraint->getTitle());
+    const EvaluationState* pState = ctx.find(pConstraint);
+    if ( pState ) {
+      pObj->set("passed", pState->bPassed);
+      pObj->set("checkPassed", pState->bCheckPassed);
+      pObj->set("deferred", pState->deferredResultCnt > 0);
+      if ( pState->deferredResultCnt > 0 ) {
+        unsigned long delayMs = pState->bPassed ? pConstraint->getFailDelayMs() : pConstraint->getPassDelayMs();
+        unsigned long elapsedMs = ctx.nowMs - pState->deferredTimeMs;
+        pObj->set("deferredRemainingMs", (Poco::UInt64) (elapsedMs < delayMs ? delayMs - elapsedMs : 0));
+      }
+    } else {
+      pObj->set("evaluated", false); // skipped by a short circuit or disabled parent
+      pObj->set("passed", pConstraint->isPassed());
+    }
+    if ( !pConstraint->getChildren().empty() ) {
+      Poco::JSON::Array children;
+      for ( auto pChild : pConstraint->getChildren() ) {
+        children.add(evaluationToJson(ctx,pChild));
+      }
+      pObj->set("children", children);
+    }
+    return pObj;
+  }
+
+  // POST /whatif
+  // {
+  //   "name": "*HVAC*",                              devices to evaluate (title wildcard, default all)
+  //   "sensors": { "Chargers Input Power": 900 },    sensor values by name or id
+  //   "capabilities": { "12": 1 },                   capability values by id
+  //   "offsetMs": 0,                                 virtual time relative to now
+  //   "steps": 1, "stepMs": 15000,                   evaluate repeatedly holding the values (deferral delays)
+  //   "sweep": { "sensor": "Chargers Input Power", "from": 0, "to": 2000, "step": 50 },
+  //   "verbose": false                               include per constraint results
+  // }
+  void DefaultRequestHandler::handleWhatIf(ostream& out, Poco::JSON::Object::Ptr pReqObj) {
+    SolarPowerMgrApp* pApp = SolarPowerMgrApp::pInstance;
+
+    auto findSensor = [pApp](const string& strKey) -> Sensor* {
+      int id;
+      vector<Sensor*> found;
+      if ( NumberParser::tryParse(strKey,id) ) {
+        pApp->sensors.findById(id,found);
+      } else {
+        for ( auto pSensor : pApp->sensors ) {
+          if ( pSensor->name == strKey ) {
+            found.push_back(pSensor);
+            break;
+          }
+        }
+      }
+      if ( found.empty() ) {
+        throw Poco::NotFoundException("whatif sensor", strKey);
+      }
+      return found[0];
+    };
+
+    Devices devices;
+    string strName = pReqObj->optValue<string>("name","*");
+    pApp->devices.findByTitleLike(strName.c_str(),devices);
+    if ( devices.empty() ) {
+      throw Poco::NotFoundException("whatif device", strName);
+    }
+
+    long offsetMs = pReqObj->optValue<Poco::Int64>("offsetMs",0);
+    int steps = std::max(1,pReqObj->optValue<int>("steps",1));
+    unsigned long stepMs = pReqObj->optValue<Poco::UInt64>("stepMs",15000);
+    bool bVerbose = pReqObj->optValue<bool>("verbose",false);
+    if ( (double)steps*devices.size() > MAX_WHATIF_EVALUATIONS ) {
+      throw Poco::InvalidArgumentException("whatif has too many steps");
+    }
+
+    EvaluationContext overlay(offsetMs);
+
+    Poco::JSON::Object::Ptr pSensors = pReqObj->getObject("sensors");
+    if ( pSensors ) {
+      for ( auto& entry : *pSensors ) {
+        overlay.setValue(findSensor(entry.first), entry.second.convert<float>());
+      }
+    }
+    Poco::JSON::Object::Ptr pCapabilities = pReqObj->getObject("capabilities");
+    if ( pCapabilities ) {
+      for ( auto& entry : *pCapabilities ) {
+        vector<Capability*> found;
+        Capabilities(Capability::all()).findById(NumberParser::parse(entry.first),found);
+        if ( found.empty() ) {
+          throw Poco::NotFoundException("whatif capability", entry.first);
+        }
+        overlay.setValue(found[0], entry.second.convert<float>());
+      }
+    }
+
+    Sensor* pSweepSensor = nullptr;
+    vector<float> sweepValues;
+    Poco::JSON::Object::Ptr pSweep = pReqObj->getObject("sweep");
+    if ( pSweep ) {
+      pSweepSensor = findSensor(pSweep->getValue<string>("sensor"));
+      float from = pSweep->getValue<float>("from"), to = pSweep->getValue<float>("to");
+      float step = std::fabs(pSweep->optValue<float>("step",1));
+      if ( !std::isfinite(from) || !std::isfinite(to) || !std::isfinite(step) || step == 0 ) {
+        throw Poco::InvalidArgumentException("whatif sweep needs finite from, to and a non zero step");
+      }
+      // count first so large values with a small step (val += step not changing val) can not loop forever
+      double valueCnt = std::floor(std::fabs((double)to-from)/step) + 1;
+      if ( valueCnt*steps*devices.size() > MAX_WHATIF_EVALUATIONS ) {
+        throw Poco::InvalidArgumentException("whatif sweep has too many values");
+      }
+      double signedStep = from <= to ? step : -step;
+      for ( int i = 0; i < (int) valueCnt; i++ ) {
+        sweepValues.push_back((float) (from + i*signedStep));
+      }
+    } else {
+      sweepValues.push_back(NAN);
+    }
+
+    Poco::JSON::Array results;
+    for ( float sweepValue : sweepValues ) {
+      EvaluationContext ctx(overlay);
+      if ( pSweepSensor ) {
+        ctx.setValue(pSweepSensor, sweepValue);
+      }
+      for ( int i = 1; i < steps; i++ ) {
+        for ( auto pDevice : devices ) {
+          if ( pDevice->getConstraint() ) {
+            pDevice->getConstraint()->evaluate(ctx);
+          }
+        }
+        ctx.advance(stepMs);
+      }
+      Poco::JSON::Array deviceResults;
+      for ( auto pDevice : devices ) {
+        Constraint* pConstraint = pDevice->getConstraint();
+        Poco::JSON::Object::Ptr pDeviceObj = new Poco::JSON::Object(true);
+        pDeviceObj->set("id", (int) pDevice->id);
+        pDeviceObj->set("name", pDevice->name);
+        if ( pConstraint ) {
+          pDeviceObj->set("passed", pConstraint->evaluate(ctx));
+          if ( bVerbose ) {
+            pDeviceObj->set("constraint", evaluationToJson(ctx,pConstraint));
+          }
+        }
+        deviceResults.add(pDeviceObj);
+      }
+      Poco::JSON::Object::Ptr pResult = new Poco::JSON::Object(true);
+      if ( pSweepSensor ) {
+        pResult->set("value", sweepValue);
+      }
+      pResult->set("devices", deviceResults);
+      results.add(pResult);
+    }
+
+    Poco::JSON::Object respObj(true);
+    respObj.set("whatif", results);
+    writeJsonResp(out, 0, "OK", respObj);
+  }
+
   void DefaultRequestHandler::writeJsonResp(ostream& out, int statusCode, const string& statusMsg, Poco::JSON::Object& obj) {
     obj.set("respCode", statusCode);
     obj.set("respMsg", statusMsg);
@@ -43,6 +43,7 @@ protected:
   void writeJsonResp(ostream& out, int statusCode, const string& statusMsg, Poco::JSON::Object& obj);
   void writeJsonResp(ostream& out, int statusCode, const char* statusMsg, Poco::JSON::Object& obj) { writeJsonResp(out,statusCode,string(statusMsg),obj); }
   void writeJsonResp(ostream& out, int statusCode, const string& statusMsg);
+  void handleWhatIf(ostream& out, Poco::JSON::Object::Ptr pReqObj);
 };
 
 class RequestHandlerFactory : public HTTPRequestHandlerFactory
@@ -2,6 +2,8 @@
 #define SOLAR_IFTTT_PROMETHEUS_H
 
 #include "automation/sensor/Sensor.h"
+#include "automation/CircuitBreaker.h"
+#include "xmonit/HttpClientPool.h"
 
 #include <Poco/URI.h>
 #include <Poco/Net/HTTPClientSession.h>
@@ -101,13 +103,12 @@ public:
   Poco::URI url;
 
   Prometheus::MetricMap metrics;
-  Poco::Net::HTTPClientSession session;
   string path;
   function<bool(const Metric &)> metricFilter;
+  automation::CircuitBreaker breaker; // metrics stay empty (sensors NAN) while open
 
   DataSource(const Poco::URI &url, function<bool(const Metric &)> metricFilter) : url(url),
                                                                                   metricFilter(metricFilter),
-                                                                                  session(url.getHost(), url.getPort()),
                                                                                   path(url.getPathAndQuery())
   {
     if (path.empty())
@@ -162,27 +163,33 @@ public:
   virtual bool loadMetrics()
   {
     metrics.clear();
+    if (!breaker.allow())
+    {
+      return false;
+    }
     try
     {
+      xmonit::HttpClientPool::Lease pSession = xmonit::HttpClientPool::instance.acquire(url.getHost(), url.getPort(), url.getScheme() == "https");
       Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, path, Poco::Net::HTTPMessage::HTTP_1_1);
-      session.sendRequest(request);
+      pSession->sendRequest(request);
 
       Poco::Net::HTTPResponse response;
-      std::istream &rs = session.receiveResponse(response);
+      std::istream &rs = pSession->receiveResponse(response);
 
       if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK)
       {
         if (!parseMetrics(rs, metrics, metricFilter))
         {
           cerr << "FAILED parsing metrics." << endl;
-          automation::sleep(5000);
+          breaker.failed();
           return false;
         }
+        pSession.done();
       }
       else
       {
         cerr << "FAILED retrieving metrics.  URL: " << url.toString() << ", reason: " << Poco::Net::HTTPResponse::getReasonForStatus(response.getStatus()) << endl;
-        automation::sleep(5000);
+        breaker.failed();
         return false;
       }
     }
@@ -190,7 +197,10 @@ public:
     {
       cerr << "FAILED loading prometheus metrics." << endl;
       cerr << ex.displayText() << endl;
+      breaker.failed();
+      return false;
     }
+    breaker.succeeded();
     return true;
   }
 
@@ -1,6 +1,10 @@
 #include "SolarPowerMgrApp.h"
 
 #include "xmonit/OpenHabSwitch.h"
+#include "xmonit/OpenHabEventStream.h"
+#include "xmonit/HttpClientPool.h"
+#include "xmonit/DnsCache.h"
+#include "xmonit/ActuatorMetrics.h"
 #include "xmonit/GpioPowerSwitch.h"
 #include "automation/Automation.h"
 #include "automation/json/JsonStreamWriter.h"
@@ -8,13 +12,19 @@
 #include "automation/constraint/NotConstraint.h"
 #include "automation/constraint/AndConstraint.h"
 #include "automation/constraint/OrConstraint.h"
+#include "automation/constraint/ComparisonCache.h"
 #include "automation/constraint/BooleanConstraint.h"
 #include "automation/constraint/ValueConstraint.h"
+#include "automation/constraint/StaticValueConstraint.h"
 #include "automation/constraint/ToggleConstraint.h"
 #include "automation/constraint/SimultaneousConstraint.h"
 #include "automation/constraint/TimeRangeConstraint.h"
 #include "automation/constraint/TransitionDurationConstraint.h"
 #include "automation/device/Device.h"
+#include "automation/device/PowerBudget.h"
+#include "automation/device/PowerAllocator.h"
+#include "automation/sensor/SamplingService.h"
+#include "automation/sensor/FilterSensor.h"
 #include "automation/Cacheable.h"
 #include "xmonit/OneWireTherm.h"
 
@@ -27,6 +37,8 @@
 #include <memory>
 
 #include <prometheus/gauge.h>
+#include <prometheus/counter.h>
+#include <prometheus/histogram.h>
 #include <prometheus/exposer.h>
 #include <prometheus/registry.h>
 
@@ -54,11 +66,28 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
   static float maxOutputPower = (float) conf.getDouble("maxOutputPower",2200); // load is kept below available input power or this configured max
                                                                                // workaround for defective thermal fuse tripping too soon
   ulong maxSensorCacheAgeMs = conf.getDouble("maxSensorCacheAgeMs",15000); // min period before reloading prometheus metrics from solar-web-service
-  ulong errorPauseMs = conf.getDouble("errorPauseMs",60000);  
+  // failing devices and metric sources are skipped for minOpenMs doubling up to maxOpenMs while the rest keep running
+  ulong breakerMinOpenMs = conf.getDouble("breaker[@minOpenMs]",maxSensorCacheAgeMs);
+  ulong breakerMaxOpenMs = conf.getDouble("breaker[@maxOpenMs]",5*MINUTES);
+  unsigned int breakerFailureThreshold = conf.getInt("breaker[@failureThreshold]",1);
   ulong idlePauseMs = conf.getDouble("idlePauseMs",5000);
 
   cout << "app.xml: maxInputPower=" << maxInputPower << endl;
 
+  // outbound requests (prometheus, openhab, xmonit and ifttt) share keep-alive connections
+  xmonit::HttpClientPool& httpClientPool = xmonit::HttpClientPool::instance;
+  httpClientPool.connectTimeoutMs = conf.getInt("httpClient[@connectTimeoutMs]", httpClientPool.connectTimeoutMs);
+  httpClientPool.readTimeoutMs = conf.getInt("httpClient[@readTimeoutMs]", httpClientPool.readTimeoutMs);
+  httpClientPool.keepAliveMs = conf.getInt("httpClient[@keepAliveMs]", httpClientPool.keepAliveMs);
+  httpClientPool.maxConnectionsPerHost = conf.getInt("httpClient[@maxConnectionsPerHost]", httpClientPool.maxConnectionsPerHost);
+  xmonit::DnsCache::instance.ttlMs = conf.getInt("httpClient[@dnsTtlMs]", xmonit::DnsCache::instance.ttlMs);
+
+  // all openhab switches share one client and fetch their item states together
+  xmonit::OpenHabClient::instance.configure(conf.getString("openHab[@host]","openhab"), conf.getInt("openHab[@port]",8080), conf.getString("openHab[@tag]",""));
+
+  // gpio switches use the gpio character device unless configured otherwise ("exec" runs the WiringPi gpio command)
+  xmonit::GpioBackend::setDefault(xmonit::GpioBackend::create(conf.getString("gpio[@backend]","chardev"), conf.getString("gpio[@path]","/dev/gpiochip0")));
+
   static auto metricFilter = [](const Prometheus::Metric &metric) { return metric.name.find("solar") == 0 
                                                                     || metric.name.find("arduino_solar") == 0; };
 
@@ -68,44 +97,48 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
   static SensorFn soc("State of Charge", []() -> float { return prometheusDs.metrics["solar_charger_batterySOC"].avg(); });
   static SensorFn chargersInputPower("Chargers Input Power",
                                      []() -> float { return std::min(prometheusDs.metrics["solar_charger_inputPower"].total(),maxInputPower); });
-  static SensorFn batteryBankVoltage("Battery Bank Voltage",
+  static SensorFn batteryBankVoltageRaw("Battery Bank Voltage Raw",
                                      []() -> float { return prometheusDs.metrics["solar_charger_outputVoltage"].avg(); });
-  static SensorFn batteryBankPower("Battery Bank Power",
-                                  //TODO - adjust arduino current and voltage sensors for more accurate reading. for now just compensate to reduce it
-                                   []() -> float { return prometheusDs.metrics["arduino_solar_batteryBankPower"].avg() * 0.965;  });
+  // a single bad voltage reading should not shed loads that then wait out their min off duration.  The cost is
+  // latency: a real sag more than 0.15V below the window median is replaced for 3 refreshes (~15s at the default
+  // idlePauseMs) so cutoffVoltage and minVoltage see it on the 4th refresh.
+  static HampelStage<5> batteryBankVoltageOutliers(3, 0.05);
+  static FilterSensor batteryBankVoltage("Battery Bank Voltage", batteryBankVoltageRaw, {&batteryBankVoltageOutliers});
+  static SensorFn batteryBankPowerRaw("Battery Bank Power Raw",
+                                   []() -> float { return prometheusDs.metrics["arduino_solar_batteryBankPower"].avg(); });
+  //TODO - adjust arduino current and voltage sensors for more accurate reading. for now just compensate to reduce it
+  static CalibrationStage batteryBankPowerCalibration(0.965);
+  static FilterSensor batteryBankPower("Battery Bank Power", batteryBankPowerRaw, {&batteryBankPowerCalibration});
   
+  // raw sensors before their filters so filters see refreshed readings
   sensors.push_back(&soc);
   sensors.push_back(&chargersInputPower);
+  sensors.push_back(&batteryBankVoltageRaw);
   sensors.push_back(&batteryBankVoltage);
+  sensors.push_back(&batteryBankPowerRaw);
   sensors.push_back(&batteryBankPower);
 
+  static PowerBudget powerBudget;
+
+  // depends on device being evaluated so not cacheable
   static SensorFn requiredPowerTotal("Required Power", []() -> float {
-    float requiredWatts = 0;
-    for (automation::Device *pDevice : pInstance->devices)
-    {
-      automation::PowerSwitch *pPowerSwitch = dynamic_cast<automation::PowerSwitch*>(pDevice);
-      if ( !pPowerSwitch ) {
-        continue;
-      }
-      if (pPowerSwitch->isOn() || pDevice == pInstance->currentDevice)
-      {
-        requiredWatts += pPowerSwitch->requiredWatts;
-      }
-    }
+    const automation::Device* pCurrentDevice = pInstance->currentDevice;
+    float requiredWatts = powerBudget.getRequiredWatts(pCurrentDevice);
     float battBankWatts = batteryBankPower.getValue();
     if (isnan(battBankWatts))
     {
       return requiredWatts;
     }
     else {
-      automation::PowerSwitch *pCurrentPowerSwitch = dynamic_cast<automation::PowerSwitch*>(pInstance->currentDevice);
-      if (pCurrentPowerSwitch && !pCurrentPowerSwitch->isOn())
+      const automation::PowerSwitch *pCurrentPowerSwitch = dynamic_cast<const automation::PowerSwitch*>(pCurrentDevice);
+      if (pCurrentPowerSwitch && !powerBudget.isOn(pCurrentPowerSwitch))
       {
         battBankWatts += pCurrentPowerSwitch->requiredWatts;
       }
       return std::max(requiredWatts, battBankWatts);
     }
   });
+  requiredPowerTotal.setCacheable(false);
 
   static auto prometheusRegistry = std::make_shared<Registry>();
 
@@ -113,29 +146,70 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
   vector<std::unique_ptr<xmonit::OneWireThermSensor>> oneWireThermSensors;
   xmonit::OneWireThermSensor::createSensors(conf,oneWireThermSensors);
 
-  struct SensorMetric : automation::SensorListener {
-    prometheus::Gauge *pGauge;
-    SensorMetric(prometheus::Family<Gauge> *pSensorGauges, map<string,string>& labels){
-      pGauge = &pSensorGauges->Add(labels);
+  // Sensor changes are queued as they happen and set on the gauges together once per tick by flush()
+  static struct SensorMetrics : automation::SensorListener {
+    prometheus::Gauge* gauges[automation::NumericIdentifierMax+1] = {}; // by sensor id
+    mutable vector<pair<prometheus::Gauge*,float>> pending;
+
+    void add(Sensor* pSensor, prometheus::Family<Gauge> *pSensorGauges, const map<string,string>& labels, float deadband, ulong minIntervalMs) {
+      gauges[pSensor->id] = &pSensorGauges->Add(labels);
+      pSensor->addListener(this, deadband, minIntervalMs);
     }
     void changed(const Sensor* pSensor, float newVal, float oldVal) const override {
-      pGauge->Set(newVal);
-    }   
-  };
+      pending.push_back({gauges[pSensor->id], newVal});
+    }
+    void flush() {
+      for ( auto& update : pending ) {
+        update.first->Set(update.second);
+      }
+      pending.clear();
+    }
+  } sensorMetrics;
+
+  float sensorDeadband = conf.getDouble("prometheus[@sensorDeadband]", 0);
+  ulong sensorMinIntervalMs = conf.getDouble("prometheus[@sensorMinIntervalMs]", 0);
 
   prometheus::Family<Gauge> *pSensorGauges = &(BuildGauge().Name("solar_power_mgr_sensor").Labels({{"type", "statistic"}}).Register(*prometheusRegistry));
   for( auto& s : sensors) {
-    map<string,string> labels = {{"name",s->name}};
-    s->pListener = unique_ptr<SensorMetric>(new SensorMetric(pSensorGauges,labels));
+    sensorMetrics.add(s, pSensorGauges, {{"name",s->name}}, sensorDeadband, sensorMinIntervalMs);
   }
   
   pSensorGauges = &(BuildGauge().Name("solar_power_mgr_sensor").Labels({{"type", "OneWireTherm"}}).Register(*prometheusRegistry));
   for( auto& s : oneWireThermSensors) {
     sensors.push_back(s.get());
-    map<string,string> labels = {{"metric", "celciusTemp"},{"name",s->name}, {"title",s->getTitle()}};
-    s->pListener = unique_ptr<SensorMetric>(new SensorMetric(pSensorGauges,labels));
+    sensorMetrics.add(s.get(), pSensorGauges, {{"metric", "celciusTemp"},{"name",s->name}, {"title",s->getTitle()}}, sensorDeadband, sensorMinIntervalMs);
   }
 
+  // connection reuse of the shared http client pool and its dns lookups
+  static struct HttpClientMetrics {
+    prometheus::Gauge *pLeases, *pConnects, *pReuses, *pDiscards, *pTimeouts;
+    prometheus::Gauge *pDnsLookups, *pDnsFailures, *pDnsStale;
+
+    void init(prometheus::Family<Gauge> *pGauges) {
+      pLeases = &pGauges->Add({{"metric", "leases"}});
+      pConnects = &pGauges->Add({{"metric", "connects"}});
+      pReuses = &pGauges->Add({{"metric", "reuses"}});
+      pDiscards = &pGauges->Add({{"metric", "discards"}});
+      pTimeouts = &pGauges->Add({{"metric", "timeouts"}});
+      pDnsLookups = &pGauges->Add({{"metric", "dnsLookups"}});
+      pDnsFailures = &pGauges->Add({{"metric", "dnsFailures"}});
+      pDnsStale = &pGauges->Add({{"metric", "dnsStale"}});
+    }
+    void update() {
+      xmonit::HttpClientPool::Stats stats = xmonit::HttpClientPool::instance.getStats();
+      pLeases->Set(stats.leases);
+      pConnects->Set(stats.connects);
+      pReuses->Set(stats.reuses);
+      pDiscards->Set(stats.discards);
+      pTimeouts->Set(stats.timeouts);
+      xmonit::DnsCache::Stats dnsStats = xmonit::DnsCache::instance.getStats();
+      pDnsLookups->Set(dnsStats.lookups);
+      pDnsFailures->Set(dnsStats.failures);
+      pDnsStale->Set(dnsStats.stale);
+    }
+  } httpClientMetrics;
+  httpClientMetrics.init(&(BuildGauge().Name("solar_power_mgr_http_client").Register(*prometheusRegistry)));
+
   struct PowerSwitchMetrics : Capability::CapabilityListener
   {
     prometheus::Family<Gauge> *pGauges;
@@ -155,11 +229,15 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
     }
   };
 
+  // stagger starts so inrush of HVAC compressors and lights do not overlap.  HVACs are first in line.
+  static StartCoordinator startCoordinator{30 * SECONDS};
+  static const int HVAC_START_PRIORITY = 1, LIGHTS_START_PRIORITY = 0;
+
   static struct HvacSwitch : xmonit::OpenHabSwitch
   {    
     AtLeast<float, Sensor &> minVoltage{DEFAULT_MIN_VOLTS, batteryBankVoltage};
     AtLeast<float, Sensor &> cutoffVoltage{23.60, batteryBankVoltage};
-    AtMost<float, Sensor&> cutoffPower{maxOutputPower,batteryBankPower};
+    SensorAtMost<FilterSensor> cutoffPower{batteryBankPower, maxOutputPower};
     AtLeast<float, Sensor &> haveRequiredPower{requiredPowerTotal, chargersInputPower};
     AtLeast<float, Sensor &> fullSoc{FULL_SOC_PERCENT, soc};
     OrConstraint fullSocOrEnoughPower{{&fullSoc, &haveRequiredPower}};
@@ -169,6 +247,7 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
     TransitionDurationConstraint minOffDuration{4 * MINUTES, &toggle, 0, 1};
     AndConstraint hvacConstraints{{&timeRange, &notSimultaneousToggleOn, &minVoltage, &cutoffVoltage, &fullSocOrEnoughPower, &minOffDuration, &cutoffPower}};
     PowerSwitchMetrics metrics;
+    PowerReservationHandler powerReservation{powerBudget, this}; // reserves watts while haveRequiredPower waits out its pass delay
 
     HvacSwitch(const string& title, const string& openHabItem, const TimeRangeConstraint::Time& start, const TimeRangeConstraint::Time& end) : 
       xmonit::OpenHabSwitch(title, openHabItem, DEFAULT_APPLIANCE_WATTS), 
@@ -176,8 +255,11 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
     {
       fullSoc.setPassDelayMs(1 * MINUTES).setFailDelayMs(1.75 * MINUTES); // large fail delay so haveRequiredPower has time to decide. real cutoff is voltage
       haveRequiredPower.setPassDelayMs(30 * SECONDS).setFailDelayMs(1.5 * MINUTES).setFailMargin(90).setPassMargin(30);
+      haveRequiredPower.listeners.add(&powerReservation);
       minVoltage.setFailDelayMs(60 * SECONDS).setFailMargin(0.5).setPassMargin(1.25);
       cutoffVoltage.setPassMargin(3.0).setPassDelayMs(4*MINUTES);
+      simultaneousToggleOn.setCoordinator(&startCoordinator, HVAC_START_PRIORITY,
+        {&timeRange, &minVoltage, &cutoffVoltage, &fullSocOrEnoughPower, &minOffDuration, &cutoffPower});
       setConstraint(&hvacConstraints);
       metrics.init(this);
     }
@@ -218,12 +300,16 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
       &minVoltage, &fullSocOrEnoughPower, &minOffDuration}};
 
     PowerSwitchMetrics metrics;
+    PowerReservationHandler powerReservation{powerBudget, this};
 
     OpenHabLightSwitch(const string& name, const string& strOpenHabId,float requiredWatts) : xmonit::OpenHabSwitch(name,strOpenHabId,requiredWatts)
     {
       fullSoc.setPassDelayMs(0.75 * MINUTES).setFailDelayMs(1.5 * MINUTES).setFailMargin(15);
       haveRequiredPower.setPassDelayMs(1 * MINUTES).setFailDelayMs(2.5 * MINUTES).setFailMargin(25).setPassMargin(10);
+      haveRequiredPower.listeners.add(&powerReservation);
       minVoltage.setFailDelayMs(45 * SECONDS).setFailMargin(0.5);
+      simultaneousToggleOn.setCoordinator(&startCoordinator, LIGHTS_START_PRIORITY,
+        {&validTime, &oneOrMoreHvacsOff, &minVoltage, &fullSocOrEnoughPower, &minOffDuration});
       setConstraint(&familyRmAuxConstraints);
       metrics.init(this);
     }
@@ -248,12 +334,16 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
     AndConstraint plantLightsConstraints{{&validTime, &notSimultaneousToggleOn, &minVoltage, 
                                           &fullSocOrEnoughPower, &minOffDuration, &oneOrMoreHvacsOff}};
     PowerSwitchMetrics metrics;
+    PowerReservationHandler powerReservation{powerBudget, this};
 
     PlantLightsSwitch() : xmonit::GpioPowerSwitch("Plant Lights", 15 /*GPIO PIN*/, LIGHTS_SET_2_WATTS)
     {
       fullSoc.setPassDelayMs(0.5 * MINUTES).setFailDelayMs(1.5 * MINUTES).setFailMargin(15);
       haveRequiredPower.setPassDelayMs(1 * MINUTES).setFailDelayMs(2.5 * MINUTES).setFailMargin(25).setPassMargin(10);
+      haveRequiredPower.listeners.add(&powerReservation);
       minVoltage.setFailDelayMs(45 * SECONDS).setFailMargin(0.5);
+      simultaneousToggleOn.setCoordinator(&startCoordinator, LIGHTS_START_PRIORITY,
+        {&validTime, &minVoltage, &fullSocOrEnoughPower, &minOffDuration, &oneOrMoreHvacsOff});
       setConstraint(&plantLightsConstraints);
       metrics.init(this);
     }
@@ -284,14 +374,105 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
   cout << "============== End Device(s) Setup ============" << endl
        << endl;
 
+  for (auto pDevice : devices)
+  {
+    automation::PowerSwitch *pPowerSwitch = dynamic_cast<automation::PowerSwitch*>(pDevice);
+    if ( pPowerSwitch ) {
+      powerBudget.add(pPowerSwitch);
+    }
+  }
+
+  // Optional: allocate surplus power once per tick by priority and rotation credit instead of each device checking
+  // for enough power and rotating turned off devices to the end of the list
+  static PowerAllocator powerAllocator;
+  bool bUseAllocator = conf.getBool("powerAllocator[@enabled]", false);
+  if ( bUseAllocator ) {
+    powerAllocator.minVoltage = conf.getDouble("powerAllocator[@minVoltage]", DEFAULT_MIN_VOLTS);
+    powerAllocator.fullSoc = FULL_SOC_PERCENT;
+    powerAllocator.batteryAllowanceWatts = conf.getDouble("powerAllocator[@batteryAllowanceWatts]", 0);
+    powerAllocator.reserveWatts = conf.getDouble("powerAllocator[@reserveWatts]", 0);
+    powerAllocator.pInputWatts = &chargersInputPower; // what if requests evaluate allocations with their own values
+    powerAllocator.pSoc = &soc;
+    powerAllocator.pVoltage = &batteryBankVoltage;
+    ulong minOnMs = conf.getDouble("powerAllocator[@minOnMs]", 5 * MINUTES);
+    static vector<unique_ptr<Constraint>> allocationConstraints;
+    auto addLoad = [&](automation::PowerSwitch& powerSwitch, Constraint& fullSocOrEnoughPower, int priority) {
+      fullSocOrEnoughPower.mode = Constraint::PASS_MODE; // allocator decides if there is enough power
+      Constraint* pDeviceConstraint = powerSwitch.getConstraint();
+      powerAllocator.add(&powerSwitch, pDeviceConstraint, priority, minOnMs);
+      allocationConstraints.emplace_back(new AllocationConstraint(&powerAllocator, &powerSwitch));
+      Constraint* pAllocated = allocationConstraints.back().get();
+      allocationConstraints.emplace_back(new AndConstraint({pDeviceConstraint, pAllocated}));
+      powerSwitch.setConstraint(allocationConstraints.back().get());
+    };
+    addLoad(sunroomHvacSwitch, sunroomHvacSwitch.fullSocOrEnoughPower, HVAC_START_PRIORITY);
+    addLoad(familyRoomHvac1Switch, familyRoomHvac1Switch.fullSocOrEnoughPower, HVAC_START_PRIORITY);
+    addLoad(familyRoomHvac2Switch, familyRoomHvac2Switch.fullSocOrEnoughPower, HVAC_START_PRIORITY);
+    addLoad(gpioPlantLightsSwitch, gpioPlantLightsSwitch.fullSocOrEnoughPower, LIGHTS_START_PRIORITY);
+    addLoad(familyRoomAuxSwitch, familyRoomAuxSwitch.fullSocOrEnoughPower, LIGHTS_START_PRIORITY);
+    addLoad(diningRoomAuxSwitch, diningRoomAuxSwitch.fullSocOrEnoughPower, LIGHTS_START_PRIORITY);
+  }
+
+  // breaker state by device: 0 closed, 1 half open (trying again), 2 open (skipped)
+  static struct BreakerMetrics {
+    vector<pair<const automation::CircuitBreaker*,prometheus::Gauge*>> gauges;
+
+    void add(const string& name, const automation::CircuitBreaker& breaker, prometheus::Family<Gauge> *pGauges) {
+      gauges.push_back({&breaker, &pGauges->Add({{"name", name}})});
+    }
+    void update() {
+      for ( auto& breakerGauge : gauges ) {
+        automation::CircuitBreaker::State state = breakerGauge.first->getState();
+        breakerGauge.second->Set(state == automation::CircuitBreaker::State::Open ? 2 : state == automation::CircuitBreaker::State::HalfOpen ? 1 : 0);
+      }
+    }
+  } breakerMetrics;
+  prometheus::Family<Gauge> *pBreakerGauges = &(BuildGauge().Name("solar_power_mgr_breaker").Register(*prometheusRegistry));
+  for ( automation::Device *pDevice : devices ) {
+    pDevice->breaker = automation::CircuitBreaker(breakerFailureThreshold, breakerMinOpenMs, breakerMaxOpenMs);
+    breakerMetrics.add(pDevice->name, pDevice->breaker, pBreakerGauges);
+  }
+  prometheusDs.breaker = automation::CircuitBreaker(breakerFailureThreshold, breakerMinOpenMs, breakerMaxOpenMs);
+  breakerMetrics.add("prometheus", prometheusDs.breaker, pBreakerGauges);
+
+  // switch command latency and outcome (ok, timeout, httpError, parseError, error) by device.  Percentiles from the
+  // in process histogram are at GET /actuator.
+  static struct ActuatorCallMetrics {
+    struct DeviceMetrics {
+      prometheus::Histogram* pLatency;
+      prometheus::Counter* pResults[xmonit::ActuatorMetrics::RESULT_CNT];
+    };
+    map<string,DeviceMetrics> metricsByName;
+
+    void add(const string& name, prometheus::Family<Histogram> *pLatencies, prometheus::Family<Counter> *pCalls) {
+      DeviceMetrics& metrics = metricsByName[name];
+      metrics.pLatency = &pLatencies->Add({{"name", name}}, Histogram::BucketBoundaries{0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30});
+      for ( int i = 0; i < xmonit::ActuatorMetrics::RESULT_CNT; i++ ) {
+        const char* pszResult = xmonit::ActuatorMetrics::getResultName((xmonit::ActuatorMetrics::Result)i);
+        metrics.pResults[i] = &pCalls->Add({{"name", name}, {"result", pszResult}});
+      }
+    }
+    void record(const string& name, xmonit::ActuatorMetrics::Result result, unsigned long durationUs) {
+      auto it = metricsByName.find(name);
+      if ( it != metricsByName.end() ) {
+        it->second.pLatency->Observe(durationUs / 1000000.0);
+        it->second.pResults[(int)result]->Increment();
+      }
+    }
+  } actuatorCallMetrics;
+  prometheus::Family<Histogram> *pActuatorLatencies = &(BuildHistogram().Name("solar_power_mgr_actuator_latency_seconds").Register(*prometheusRegistry));
+  prometheus::Family<Counter> *pActuatorCalls = &(BuildCounter().Name("solar_power_mgr_actuator_calls_total").Register(*prometheusRegistry));
+  for ( automation::Device *pDevice : devices ) {
+    actuatorCallMetrics.add(pDevice->name, pActuatorLatencies, pActuatorCalls);
+  }
+  xmonit::ActuatorMetrics::instance.listener = [](const string& name, xmonit::ActuatorMetrics::Result result, unsigned long durationUs) {
+    actuatorCallMetrics.record(name, result, durationUs);
+  };
+
   //w.printlnVectorObj("devices",devices,"",true);
   //w.printlnVectorObj("constraints",Constraint::all(),"",true);
 
 
-  SimultaneousConstraint::connectListeners({&familyRoomHvac1Switch.simultaneousToggleOn, &familyRoomHvac2Switch.simultaneousToggleOn,
-    &familyRoomAuxSwitch.simultaneousToggleOn, &sunroomHvacSwitch.simultaneousToggleOn, &gpioPlantLightsSwitch.simultaneousToggleOn,
-    &diningRoomAuxSwitch.simultaneousToggleOn});
-
   unsigned long nowMs = automation::millisecs();
 
   bool bFirstTime = true;
@@ -312,6 +493,24 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
   httpServer.start();
   cout << "============= End HttpListener Setup =============" << endl;
 
+  // openhab pushes item changes so switches are not polled (falls back to polling while disconnected)
+  xmonit::OpenHabEventStream openHabEvents(xmonit::OpenHabClient::instance, conf.getString("openHab[@host]","openhab"), conf.getInt("openHab[@port]",8080),
+                                           conf.getString("openHab[@eventTopicPrefix]","smarthome/items"));
+  if ( conf.getBool("openHab[@events]",true) ) {
+    openHabEvents.start();
+  }
+
+  // multi-sample sensors are averaged in the background so the loop does not sleep between their samples
+  automation::SamplingService<Poco::Mutex> samplingService(httpServer.mutex);
+  for ( auto& s : sensors ) {
+    if ( s->sampleCnt > 1 ) {
+      samplingService.add(s);
+    }
+  }
+  if ( !samplingService.empty() ) {
+    samplingService.start();
+  }
+
   Exposer exposer{conf.getString("prometheus[@exportBindAddress]", "127.0.0.1:8095")};
 
   exposer.RegisterCollectable(prometheusRegistry);
@@ -325,38 +524,57 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
 
     {
       Poco::Mutex::ScopedLock lock(httpServer.mutex);
-      
+
+      automation::SensorSnapshot::instance.release(); // read sensors directly while refreshing
+      xmonit::OpenHabClient::instance.dispatchEvents(); // switch changes pushed by openhab
+
+      // refresh phase: the only place switch state is read from the devices.  Constraints, budgets and REST output
+      // read the observed state so it is at most one tick old.  Prometheus and Grafana need switch state even if
+      // not in solarTimeRange.
+      for ( auto& d : devices ) {
+        automation::PowerSwitch *pPowerSwitch = dynamic_cast<automation::PowerSwitch*>(d);
+        if ( pPowerSwitch && pPowerSwitch->breaker.allow() ) {
+          pPowerSwitch->refreshObservedState();
+        }
+      }
+
       if ( nowMs - lastResultTimeMs > maxSensorCacheAgeMs ) {
         prometheusDs.loadMetrics(); 
         for ( auto& s : sensors ) {
-          if( !dynamic_cast<automation::Cacheable<float>*>(s) ) {
+          if( !dynamic_cast<automation::AsyncCacheable<float>*>(s) ) {
             s->reset().getValue(); // arduino compatible sensors cache value by default so call reset to clear cached value
           }
         }
-        for ( auto& d : devices ) {
-          automation::PowerSwitch *pPowerSwitch = dynamic_cast<automation::PowerSwitch*>(d);
-          if ( pPowerSwitch ) {
-            // calling isOn will force openhab and gpio switches to check if 
-            // local cached value needs to be updated with remote value.  
-            // Prometheus and Grafana need switch state even if not in solarTimeRange
-            pPowerSwitch->isOn(); 
-          }
+        powerBudget.sync(); // pick up switches turned on/off remotely (openhab UI)
+        if ( bUseAllocator ) {
+          powerAllocator.sync();
         }
         lastResultTimeMs = nowMs;
       }
 
       for ( auto& s : sensors ) {
-        automation::Cacheable<float>* pCacheable = dynamic_cast<automation::Cacheable<float>*>(s);
-        if ( pCacheable ) {
-          pCacheable->getCachedValue(); // each sensor tracks its own last cached time
+        if ( dynamic_cast<automation::AsyncCacheable<float>*>(s) ) {
+          s->reset().getValue(); // does not block, picks up results of background refreshes and starts new ones
         }
       }
+
+      // devices and REST output see the same sensor values until the next refresh
+      sensors.takeSnapshot();
+
+      flushPendingCommands(); // also while idle so remote commands are not held until devices are processed
+
+      sensorMetrics.flush();
+      httpClientMetrics.update();
+      breakerMetrics.update();
     }
 
     bool bProcessDevices = solarTimeRange.test() && bEnabled;
 
     if ( !bProcessDevices ) {
-      automation::sleep(idlePauseMs);
+      // wake up when the solar time range starts instead of up to idlePauseMs late
+      time_t now = std::time(nullptr);
+      time_t boundary = bEnabled ? solarTimeRange.nextBoundary(now) : 0;
+      automation::sleep( boundary > now ? std::min<ulong>(idlePauseMs, (boundary-now)*1000) : idlePauseMs );
       automation::logBufferToString(strLogBuffer);
       if (!strLogBuffer.empty())
       {
@@ -366,13 +584,26 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
       continue;
     }
 
-    int iDeviceErrorCnt = 0;
-    
     vector<Device*> turnedOffSwitches;
-    
+
+    if ( bUseAllocator ) {
+      Poco::Mutex::ScopedLock lock(httpServer.mutex);
+      powerAllocator.allocate(chargersInputPower.getValue(), {soc.getValue(), batteryBankVoltage.getValue()}, automation::millisecs());
+    }
+
+    // devices share sensor comparisons (voltage, soc, input power...) until endTick().  Only used while the lock is
+    // held since remote requests test constraints between devices.
+    automation::ComparisonCache::instance.beginTick();
+    automation::ComparisonCache::instance.suspend();
+
     for (automation::Device *pDevice : devices)
     {
       Poco::Mutex::ScopedLock lock(httpServer.mutex);
+      automation::ComparisonCache::ResumedScope comparisonCacheScope(automation::ComparisonCache::instance);
+
+      // an open breaker holds back refreshes, ON commands and retries until it half opens.  Constraints are still
+      // evaluated so a low voltage or cutoff OFF reaches a failing device that is on.
+      bool bBreakerAllows = pDevice->breaker.allow();
 
       currentDevice = pDevice;
       automation::PowerSwitch *pPowerSwitch = dynamic_cast<automation::PowerSwitch*>(pDevice);
@@ -380,13 +611,19 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
       automation::clearLogBuffer();
       bool bIgnoreSameState = !bFirstTime;
       pDevice->applyConstraint(bIgnoreSameState);
-      bool bIsOn = pPowerSwitch ? pPowerSwitch->isOn() : pDevice->isPassed(); // call isOn() to get remote value (can change from openhab interface)
+      if ( pPowerSwitch && (bBreakerAllows || pPowerSwitch->isOffPending()) ) {
+        pPowerSwitch->flush(); // latest state requested this tick (constraint, allocator, remote) sent once
+      }
+      bool bIsOn = pPowerSwitch ? pPowerSwitch->isOnObserved() : pDevice->isPassed(); // refreshed above or set by flush()
       if ( bIsOn && !pDevice->isPassed() ) {
         turnedOffSwitches.push_back(pDevice);
       }
-      if (pDevice->bError)
-      {
-        iDeviceErrorCnt++;
+      if ( bBreakerAllows ) {
+        pDevice->breaker.record(!pDevice->bError);
+      }
+      if ( pDevice->bError ) {
+        automation::logBuffer << "DEVICE ERROR: '" << pDevice->name << "' breaker " << pDevice->breaker.getStateName()
+                              << " (retry in " << pDevice->breaker.getRetryInMs()/1000.0 << "s)" << endl;
       }
       automation::logBufferToString(strLogBuffer);
       if (!strLogBuffer.empty() )
@@ -410,11 +647,14 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
       }
     }
     currentDevice = nullptr;
+    automation::ComparisonCache::instance.endTick();
 
-    for (automation::Device *pDevice : turnedOffSwitches) {
-      // put at end of list so other devices get higher priority (rotates air conditioners better)
-      auto it = std::find(devices.begin(),devices.end(),pDevice);
-      std::rotate(it, it + 1, devices.end());
+    if ( !bUseAllocator ) { // allocator keeps its own rotation credit
+      for (automation::Device *pDevice : turnedOffSwitches) {
+        // put at end of list so other devices get higher priority (rotates air conditioners better)
+        auto it = std::find(devices.begin(),devices.end(),pDevice);
+        std::rotate(it, it + 1, devices.end());
+      }
     }
 
     nowMs = automation::millisecs();
@@ -424,8 +664,8 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
       bFirstTime = false;
     }
 
-    // wait 60 seconds if any request fails (occasional DNS failure or network connectivity)
-    automation::sleep(iDeviceErrorCnt ? errorPauseMs : maxSensorCacheAgeMs);
+    // failing devices are held back by their breakers instead of pausing every device.  Pushed openhab changes end the wait early.
+    xmonit::OpenHabClient::instance.waitForEvents(maxSensorCacheAgeMs);
   };
 
   cout << "====================================================" << endl;
@@ -445,11 +685,21 @@ int SolarPowerMgrApp::main(const std::vector<std::string> &args)
     automation::logBufferToString(strLogBuffer);
     cout << strLogBuffer;
   }
+  openHabEvents.stop();
   httpServer.stop();
   cout << "Exiting " << (args.empty() ? "solar_ifttt" : args[0]) << endl;
   return 0;
 }
 
+void SolarPowerMgrApp::flushPendingCommands() {
+  for ( automation::Device* pDevice : devices ) {
+    automation::PowerSwitch *pPowerSwitch = dynamic_cast<automation::PowerSwitch*>(pDevice);
+    if ( pPowerSwitch && pPowerSwitch->isCommandPending() && (pPowerSwitch->isOffPending() || pPowerSwitch->breaker.allow()) ) {
+      pPowerSwitch->flush(); // OFF even while the breaker is open
+    }
+  }
+}
+
 std::ostream& SolarPowerMgrApp::printConstraintTitleAndValue(std::ostream& os, Constraint* pConstraint) const {
   CompositeConstraint* pComposite = dynamic_cast<CompositeConstraint*>(pConstraint);
   if ( pComposite ) {
@@ -66,6 +66,10 @@ public:
 
   virtual int main(const std::vector<std::string> &args);
 
+  // send commands still pending on any switch (remote changes to constraints or capabilities, idle ticks).  ON
+  // waits while the switch's breaker is open.  Call with httpServer's mutex held.
+  void flushPendingCommands();
+
   protected:
   
   std::ostream& printConstraintTitleAndValue(std::ostream& os, Constraint* pConstraint) const;
@@ -3,6 +3,12 @@
 
 #include "Automation.h"
 
+#ifndef ARDUINO_APP
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#endif
+
 namespace automation {
 
 template <typename ValueT>
@@ -29,6 +35,147 @@ class Cacheable {
     }
 };
 
+
+#ifndef ARDUINO_APP
+
+// Stale-while-revalidate cache.  Until softTtlMs the cached value is returned as is.  After softTtlMs the cached
+// value is still returned right away while loadValue() runs on a background thread.  A failed load keeps the old
+// value (and its age) and is retried softTtlMs later.  After hardTtlMs without a successful load the value is too
+// old to trust and staleValue (NAN for sensors) is returned until a load succeeds.  Only one load runs at a time no
+// matter how many callers find the value expired.  The first load is done on the caller's thread.
+//
+// Subclasses must call joinRefresh() in their destructor since loadValue() may be running.
+template <typename ValueT>
+class AsyncCacheable {
+
+    public:
+    unsigned long softTtlMs;
+    unsigned long hardTtlMs;
+    ValueT staleValue;
+
+    AsyncCacheable(unsigned long softTtlMs, unsigned long hardTtlMs, ValueT staleValue) :
+        softTtlMs(softTtlMs), hardTtlMs(hardTtlMs), staleValue(staleValue) {
+    }
+
+    virtual ~AsyncCacheable() {
+        joinRefresh();
+    }
+
+    // Returns false if the load failed (loadedValue is then ignored).  Called without any lock held (possibly on
+    // the refresh thread).
+    virtual bool loadValue(ValueT& loadedValue) const = 0;
+
+    ValueT getCachedValue() const {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        if ( !bAttempted ) {
+            if ( !bRefreshing ) {
+                bRefreshing = true;
+                lock.unlock();
+                ValueT loadedValue {};
+                bool bOk = loadValue(loadedValue);
+                lock.lock();
+                loaded(bOk, loadedValue, generation);
+            } else {
+                refreshedCondition.wait(lock, [this]{ return !bRefreshing; });
+            }
+            return bLoaded ? value : staleValue;
+        }
+        unsigned long nowMs = automation::millisecs();
+        if ( nowMs - lastAttemptMs > softTtlMs && !bRefreshing ) {
+            startRefresh();
+        }
+        return !bLoaded || nowMs - lastLoadTimeMs > hardTtlMs ? staleValue : value;
+    }
+
+    // value known from elsewhere (result of a set command).  Discards the result of a load already running.
+    void setCachedValue(ValueT newValue) const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        value = newValue;
+        lastLoadTimeMs = lastAttemptMs = automation::millisecs();
+        bLoaded = bAttempted = true;
+        generation++;
+    }
+
+    // fresh value pushed from elsewhere (counts as a completed load).  Discards the result of a load already running.
+    void setLoadedValue(ValueT newValue) const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        value = newValue;
+        lastLoadTimeMs = lastAttemptMs = automation::millisecs();
+        bLoaded = bAttempted = true;
+        loadCnt++;
+        generation++;
+    }
+
+    bool isStale() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return !bLoaded || automation::millisecs() - lastLoadTimeMs > hardTtlMs;
+    }
+
+    // incremented by every successful load so callers can tell a fresh result from the same cached one
+    unsigned long getLoadCount() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return loadCnt;
+    }
+
+    unsigned long getFailedLoadCount() const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return failedLoadCnt;
+    }
+
+    void joinRefresh() {
+        if ( refreshThread.joinable() ) {
+            refreshThread.join();
+        }
+    }
+
+    protected:
+    mutable std::mutex cacheMutex;
+    mutable std::condition_variable refreshedCondition;
+    mutable std::thread refreshThread;
+    mutable ValueT value {};
+    mutable unsigned long lastLoadTimeMs = 0; // last successful load
+    mutable unsigned long lastAttemptMs = 0; // last load whether it succeeded or not
+    mutable unsigned long loadCnt = 0;
+    mutable unsigned long failedLoadCnt = 0;
+    mutable unsigned long generation = 0;
+    mutable bool bLoaded = false;
+    mutable bool bAttempted = false;
+    mutable bool bRefreshing = false;
+
+    // cacheMutex held
+    void startRefresh() const {
+        bRefreshing = true;
+        if ( refreshThread.joinable() ) {
+            refreshThread.join(); // previous refresh already done (bRefreshing was false)
+        }
+        unsigned long startGeneration = generation;
+        refreshThread = std::thread([this,startGeneration]() {
+            ValueT loadedValue {};
+            bool bOk = loadValue(loadedValue);
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            loaded(bOk, loadedValue, startGeneration);
+        });
+    }
+
+    // cacheMutex held
+    void loaded(bool bOk, const ValueT& loadedValue, unsigned long startGeneration) const {
+        lastAttemptMs = automation::millisecs();
+        bAttempted = true;
+        if ( !bOk ) {
+            failedLoadCnt++;
+        } else if ( startGeneration == generation ) {
+            value = loadedValue;
+            lastLoadTimeMs = lastAttemptMs;
+            bLoaded = true;
+            loadCnt++;
+        }
+        bRefreshing = false;
+        refreshedCondition.notify_all();
+    }
+};
+
+#endif
+
 }
 
 #endif
\ No newline at end of file
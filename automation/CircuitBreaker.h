@@ -0,0 +1,86 @@
+#ifndef AUTOMATION_CIRCUITBREAKER_H
+#define AUTOMATION_CIRCUITBREAKER_H
+
+#ifndef ARDUINO_APP
+
+#include "Automation.h"
+
+#include <algorithm>
+
+namespace automation {
+
+  // Stops calling an endpoint (remote switch, metrics source...) after failureThreshold consecutive failures.  While
+  // open allow() is false until the open period ends, then one trial call is allowed (half open).  A failed trial
+  // opens it again for twice as long (up to maxOpenMs) and a success closes it.
+  class CircuitBreaker {
+  public:
+
+    enum class State { Closed, Open, HalfOpen };
+
+    unsigned int failureThreshold;
+    unsigned long minOpenMs;
+    unsigned long maxOpenMs;
+
+    CircuitBreaker(unsigned int failureThreshold = 1, unsigned long minOpenMs = 15*SECONDS, unsigned long maxOpenMs = 5*MINUTES) :
+      failureThreshold(failureThreshold ? failureThreshold : 1),
+      minOpenMs(minOpenMs),
+      maxOpenMs(maxOpenMs) {
+    }
+
+    bool allow(unsigned long nowMs = millisecs()) {
+      if ( state == State::Open && nowMs - openedMs >= openMs ) {
+        state = State::HalfOpen;
+      }
+      return state != State::Open;
+    }
+
+    void succeeded() {
+      state = State::Closed;
+      failureCnt = 0;
+      openMs = 0;
+    }
+
+    void failed(unsigned long nowMs = millisecs()) {
+      failureCnt++;
+      if ( state == State::HalfOpen || failureCnt >= failureThreshold ) {
+        openMs = openMs ? std::min(openMs*2, maxOpenMs) : minOpenMs;
+        openedMs = nowMs;
+        state = State::Open;
+        openCnt++;
+      }
+    }
+
+    // record the result of a call allowed by allow()
+    void record(bool bSucceeded, unsigned long nowMs = millisecs()) {
+      if ( bSucceeded ) {
+        succeeded();
+      } else {
+        failed(nowMs);
+      }
+    }
+
+    State getState() const { return state; }
+
+    const char* getStateName() const {
+      return state == State::Closed ? "closed" : state == State::Open ? "open" : "halfOpen";
+    }
+
+    unsigned int getFailureCount() const { return failureCnt; }
+    unsigned long getOpenCount() const { return openCnt; }
+
+    // time until a trial call is allowed (0 unless open)
+    unsigned long getRetryInMs(unsigned long nowMs = millisecs()) const {
+      return state == State::Open && nowMs - openedMs < openMs ? openMs - (nowMs - openedMs) : 0;
+    }
+
+  protected:
+    State state = State::Closed;
+    unsigned int failureCnt = 0;   // consecutive
+    unsigned long openCnt = 0;
+    unsigned long openedMs = 0;
+    unsigned long openMs = 0;      // length of the current (or last) open period
+  };
+}
+
+#endif
+#endif
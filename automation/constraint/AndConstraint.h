@@ -25,6 +25,21 @@ namespace automation {
       }
       return bResult;
     }
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      bool bResult = true;
+      for (Constraint *pConstraint : children) {
+        if (!pConstraint->evaluate(ctx)) {
+          bResult = false;
+          if ( bShortCircuit ) {
+            break;
+          }
+        }
+      }
+      return bResult;
+    }
+    #endif
   };
 }
 
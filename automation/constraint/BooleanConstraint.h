@@ -20,6 +20,12 @@ namespace automation {
       return bResult;
     }
 
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      return bResult;
+    }
+    #endif
+
     string getTitle() const override {
       return bResult ? "PASS" : "FAIL";
     }
@@ -0,0 +1,98 @@
+#ifndef AUTOMATION_COMPARISON_CACHE_H
+#define AUTOMATION_COMPARISON_CACHE_H
+
+#include <vector>
+
+namespace automation {
+
+  // Shares value comparison results between constraints during one pass over the devices.  Devices build their own
+  // AtLeast/AtMost/Range constraints on the same sensors (battery voltage, soc, ...) so a comparison is keyed by
+  // value source, validator and effective bounds (threshold with margin applied).  Only the comparison is shared,
+  // deferral state stays with each constraint.  Inactive (no caching) outside of beginTick()/endTick().
+  class ComparisonCache {
+  public:
+
+    struct Entry {
+      const void* pSource;
+      const void* pValidator;
+      double minVal, maxVal;
+      bool bResult;
+    };
+
+    // source values are read once per tick so all devices see the same value
+    struct SourceValue {
+      const void* pSource;
+      double value;
+    };
+
+    unsigned long hits = 0, misses = 0;
+
+    void beginTick() {
+      entries.clear();
+      sourceValues.clear();
+      bActive = true;
+    }
+
+    void endTick() {
+      bActive = false;
+    }
+
+    // Keeps the tick's comparisons but stops sharing them.  The app resumes the cache only while it holds the http
+    // server's mutex, so remote requests testing constraints between devices read live values.
+    void suspend() {
+      bActive = false;
+    }
+
+    void resume() {
+      bActive = true;
+    }
+
+    // resumes for the scope of a locked section.  Declare it after the lock so the cache is suspended before unlocking.
+    struct ResumedScope {
+      ResumedScope(ComparisonCache& cache) : cache(cache) { cache.resume(); }
+      ~ResumedScope() { cache.suspend(); }
+      ComparisonCache& cache;
+    };
+
+    bool isActive() const { return bActive; }
+
+    const Entry* find(const void* pSource, const void* pValidator, double minVal, double maxVal) {
+      // a handful of distinct comparisons per tick so linear search beats hashing
+      for ( const Entry& entry : entries ) {
+        if ( entry.pSource == pSource && entry.pValidator == pValidator && entry.minVal == minVal && entry.maxVal == maxVal ) {
+          hits++;
+          return &entry;
+        }
+      }
+      misses++;
+      return nullptr;
+    }
+
+    void add(const void* pSource, const void* pValidator, double minVal, double maxVal, bool bResult) {
+      entries.push_back({pSource,pValidator,minVal,maxVal,bResult});
+    }
+
+    bool findValue(const void* pSource, double& value) const {
+      for ( const SourceValue& sourceValue : sourceValues ) {
+        if ( sourceValue.pSource == pSource ) {
+          value = sourceValue.value;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void addValue(const void* pSource, double value) {
+      sourceValues.push_back({pSource,value});
+    }
+
+    static ComparisonCache instance;
+
+  protected:
+    bool bActive = false;
+    std::vector<Entry> entries;
+    std::vector<SourceValue> sourceValues;
+  };
+
+}
+#endif
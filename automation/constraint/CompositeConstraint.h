@@ -23,10 +23,6 @@ namespace automation {
       return strJoinName;
     }
 
-    const vector<Constraint*>& getChildren() {
-      return children;
-    }
-
     string getTitle() const override {
       string title = "(";
       for (size_t i = 0; i < children.size(); i++) {
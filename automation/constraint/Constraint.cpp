@@ -4,6 +4,10 @@
 
 #include "../json/JsonStreamWriter.h"
 
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#include "ComparisonCache.h"
+#endif
 
 namespace automation {
 
@@ -78,7 +82,9 @@ namespace automation {
     }
 
     if ( deferredResultCnt == 1 ) {
-      ConstraintEventHandlerList::instance.resultDeferred(this,bCheckPassed,bCheckPassed?passDelayMs:failDelayMs);
+      unsigned long delayMs = bCheckPassed ? passDelayMs : failDelayMs;
+      ConstraintEventHandlerList::instance.resultDeferred(this,bCheckPassed,delayMs);
+      listeners.resultDeferred(this,bCheckPassed,delayMs);
     }
 
     return bPassed;
@@ -108,6 +114,102 @@ namespace automation {
   }
 
 
+#ifndef ARDUINO_APP
+  // Mirrors test() and setPassed() but works on the context's copy of deferral state, uses the context clock,
+  // and does not notify ConstraintEventHandlerList::instance or listeners.
+  bool Constraint::evaluate(EvaluationContext& ctx) const
+  {
+    EvaluationState& state = evaluationState(ctx);
+    if ( !bEnabled ) {
+      return state.bPassed;
+    }
+    Mode resolvedMode = mode;
+    if ( mode != TEST_MODE ) {
+      if (mode&REMOTE_MODE) {
+        if ( pRemoteExpiredOp->test() ) {
+          resolvedMode = mode-REMOTE_MODE;
+          if ( resolvedMode == 0 ) {
+            state.bCheckPassed = evaluateValue(ctx);
+            return state.bPassed;
+          }
+        } else {
+          state.bCheckPassed = evaluateValue(ctx);
+          return state.bPassed;
+        }
+      }
+      if ( resolvedMode == PASS_MODE || resolvedMode == FAIL_MODE || resolvedMode == INVALID_MODE ) {
+        state.deferredTimeMs = ctx.nowMs;
+        state.deferredResultCnt = 0;
+        state.bCheckPassed = resolvedMode == PASS_MODE;
+        setPassed(ctx,state.bCheckPassed);
+        return state.bPassed;
+      }
+    }
+
+    bool bCheckPassed = evaluateValue(ctx);
+    state.bCheckPassed = bCheckPassed;
+
+    if ( !state.deferredTimeMs ) {
+      state.deferredTimeMs = ctx.nowMs ? ctx.nowMs : 1;
+      setPassed(ctx,bCheckPassed);
+    } else if ( state.bPassed != bCheckPassed ) {
+      if ( state.deferredResultCnt == 0 ) {
+        state.deferredTimeMs = ctx.nowMs;
+      }
+      unsigned long deferredMs = ctx.nowMs - state.deferredTimeMs;
+      if ( bCheckPassed ) {
+        if ( deferredMs >= passDelayMs ) {
+          resetDeferredDuration(ctx); // see test()
+          if ( evaluateValue(ctx) ) {
+            setPassed(ctx,true);
+          }
+        } else {
+          state.deferredResultCnt++;
+        }
+      } else {
+        if ( deferredMs >= failDelayMs ) {
+          setPassed(ctx,false);
+        } else {
+          state.deferredResultCnt++;
+        }
+      }
+    } else if ( state.deferredResultCnt > 0 ) {
+      setPassed(ctx,bCheckPassed);
+    }
+    return state.bPassed;
+  }
+
+  EvaluationState& Constraint::evaluationState(EvaluationContext& ctx) const {
+    auto it = ctx.states.find(this);
+    if ( it == ctx.states.end() ) {
+      EvaluationState state{bPassed,bPassed,deferredTimeMs,changeTimeMs,deferredResultCnt};
+      it = ctx.states.insert(std::make_pair(this,state)).first;
+    }
+    return it->second;
+  }
+
+  void Constraint::resetDeferredDuration(EvaluationContext& ctx) const {
+    EvaluationState& state = evaluationState(ctx);
+    state.deferredTimeMs = 0;
+    state.deferredResultCnt = 0;
+    for ( auto pChild : children ) {
+      pChild->resetDeferredDuration(ctx);
+    }
+  }
+
+  void Constraint::setPassed(EvaluationContext& ctx, bool bPassed) const {
+    EvaluationState& state = evaluationState(ctx);
+    if ( bPassed != state.bPassed ) {
+      state.deferredResultCnt = 0;
+      state.bPassed = bPassed;
+      state.changeTimeMs = ctx.nowMs;
+    } else if ( state.deferredResultCnt ) {
+      state.deferredResultCnt = 0;
+      state.deferredTimeMs = ctx.nowMs;
+    }
+  }
+#endif
+
   SetCode Constraint::setAttribute(const char* pszKey, const char* pszVal, ostream* pRespStream) {
     string strResultValue;
     SetCode rtn = AttributeContainer::setAttribute(pszKey,pszVal,pRespStream);
@@ -222,6 +324,9 @@ namespace automation {
 
   Constraint::RemoteExpiredOp Constraint::defaultRemoteExpiredOp;
   ConstraintEventHandlerList ConstraintEventHandlerList::instance;
+  #ifndef ARDUINO_APP
+  ComparisonCache ComparisonCache::instance;
+  #endif
 
 }
 
@@ -15,6 +15,17 @@ using namespace std;
 
 namespace automation {
 
+  #ifndef ARDUINO_APP
+  class EvaluationContext;
+
+  // Copy of a constraint's deferral state held by an EvaluationContext
+  struct EvaluationState {
+    bool bPassed, bCheckPassed;
+    unsigned long deferredTimeMs, changeTimeMs;
+    unsigned int deferredResultCnt;
+  };
+  #endif
+
   class Constraint : public AttributeContainer {
 
     public:
@@ -92,6 +103,16 @@ namespace automation {
     virtual bool checkValue() = 0;
     virtual string getTitle() const { return getType(); }
     virtual bool test();
+
+    #ifndef ARDUINO_APP
+    // Side effect free version of test() for "what if" questions.  Deferral state is copied into the context
+    // on first visit so bPassed, delays and listeners of the live constraint are untouched.
+    bool evaluate(EvaluationContext& ctx) const;
+
+    // Counterpart of checkValue() used by evaluate().  Default is the live result for constraints that have
+    // no way to evaluate against context values.
+    virtual bool evaluateValue(EvaluationContext& ctx) const { return isPassed(); }
+    #endif
     
     struct RemoteExpiredOp {
       
@@ -178,6 +199,10 @@ namespace automation {
     unsigned long getDeferredRemainingMs() const { return max(0UL,(bPassed?failDelayMs:passDelayMs) - deferredDuration()); }
     bool isDeferred() const { return deferredResultCnt > 0; }
 
+    const vector<Constraint*>& getChildren() const {
+      return children;
+    }
+
     Constraint* findChildById(unsigned int id) const {
       for ( auto pChild : children ) {
         if ( pChild->id == id ) {
@@ -229,6 +254,12 @@ namespace automation {
         return (nowMs - deferredTimeMs);
     }
 
+    #ifndef ARDUINO_APP
+    EvaluationState& evaluationState(EvaluationContext& ctx) const;
+    void resetDeferredDuration(EvaluationContext& ctx) const;
+    void setPassed(EvaluationContext& ctx, bool bPassed) const;
+    #endif
+
   };
 
   class Constraints : public AttributeContainerVector<Constraint*> {
@@ -0,0 +1,82 @@
+#ifndef AUTOMATION_EVALUATION_CONTEXT_H
+#define AUTOMATION_EVALUATION_CONTEXT_H
+
+#include "Constraint.h"
+#include "../sensor/Sensor.h"
+#include "../capability/Capability.h"
+
+#include <map>
+#include <ctime>
+
+namespace automation {
+
+  // Values and clock used by Constraint::evaluate() to answer "what if" questions such as "would the HVAC turn on
+  // if input power was 900W".  Sensors and capabilities not overridden report their live values.  Deferral state
+  // of each constraint is copied on first visit and kept here so evaluating again with a later time continues
+  // from the copy (lets a caller simulate holding the overridden values for a while).
+  class EvaluationContext {
+  public:
+
+    unsigned long nowMs;
+    time_t now;
+
+    std::map<const ValueHolder<float>*,float> values;
+    std::map<const Capability*,float> capabilityValues;
+    std::map<const Constraint*,EvaluationState> states;
+
+    EvaluationContext(long offsetMs = 0) :
+      nowMs(automation::millisecs() + offsetMs),
+      now(std::time(nullptr) + offsetMs/1000),
+      startMs(nowMs),
+      startTime(now) {
+    }
+
+    EvaluationContext& setValue(const ValueHolder<float>* pSource, float value) {
+      values[pSource] = value;
+      return *this;
+    }
+
+    EvaluationContext& setValue(const Capability* pCapability, float value) {
+      capabilityValues[pCapability] = value;
+      return *this;
+    }
+
+    EvaluationContext& advance(unsigned long durationMs) {
+      nowMs += durationMs;
+      now = startTime + (nowMs - startMs)/1000; // from total elapsed so sub-second steps add up
+      return *this;
+    }
+
+    float getValue(const ValueHolder<float>& source) const {
+      auto it = values.find(&source);
+      return it == values.end() ? source.getValue() : it->second;
+    }
+
+    // only float sources can be overridden (thresholds of integral constraints report live values)
+    template<typename ValueT>
+    ValueT getValue(const ValueHolder<ValueT>& source) const {
+      return source.getValue();
+    }
+
+    float getValue(const Capability& capability) const {
+      auto it = capabilityValues.find(&capability);
+      return it == capabilityValues.end() ? capability.getValue() : it->second;
+    }
+
+    const EvaluationState* find(const Constraint* pConstraint) const {
+      auto it = states.find(pConstraint);
+      return it == states.end() ? nullptr : &it->second;
+    }
+
+    // forget copied deferral state but keep overridden values (next evaluate() starts from live state again)
+    void clearStates() {
+      states.clear();
+    }
+
+  protected:
+    unsigned long startMs;
+    time_t startTime;
+  };
+
+}
+#endif
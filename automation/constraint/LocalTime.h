@@ -0,0 +1,45 @@
+#ifndef AUTOMATION_LOCAL_TIME_H
+#define AUTOMATION_LOCAL_TIME_H
+
+#include <ctime>
+
+namespace automation {
+
+  // Broken down local time shared by time based constraints.  localtime() (and mktime) re-read timezone state so
+  // the result is cached until the clock moves to the next second which makes it one call per pass over the devices.
+  // The server caches per thread since the main loop, what-if evaluation and http threads all test constraints.
+  class LocalTime {
+  public:
+
+    static const struct tm& get(time_t now) {
+      #ifdef ARDUINO_APP
+      static time_t cachedTime = -1;
+      static struct tm cachedTm;
+      if ( now != cachedTime ) {
+        cachedTm = *localtime(&now);
+        cachedTime = now;
+      }
+      #else
+      thread_local time_t cachedTime = -1;
+      thread_local struct tm cachedTm;
+      if ( now != cachedTime ) {
+        localtime_r(&now, &cachedTm);
+        cachedTime = now;
+      }
+      #endif
+      return cachedTm;
+    }
+
+    static const struct tm& now() {
+      return get(std::time(nullptr));
+    }
+
+    static long secondsOfDay(const struct tm& t) {
+      return t.tm_hour*3600L + t.tm_min*60L + t.tm_sec;
+    }
+
+    static const long SECONDS_PER_DAY = 24*3600L;
+  };
+
+}
+#endif
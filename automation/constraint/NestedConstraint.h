@@ -18,6 +18,14 @@ namespace automation {
       //return outerCheckValue(pConstraint->checkValue());
     }
 
+    #ifndef ARDUINO_APP
+    virtual bool outerEvaluateValue(bool bInnerResult, EvaluationContext& ctx) const = 0;
+
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      return outerEvaluateValue(inner()->evaluate(ctx),ctx);
+    }
+    #endif
+
     Constraint* inner() const {
       return children[0];
     }
@@ -16,6 +16,12 @@ namespace automation {
     bool outerCheckValue(bool bInnerResult) override {
       return !bInnerResult;
     }
+
+    #ifndef ARDUINO_APP
+    bool outerEvaluateValue(bool bInnerResult, EvaluationContext& ctx) const override {
+      return !bInnerResult;
+    }
+    #endif
   };
 
 }
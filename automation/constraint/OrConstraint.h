@@ -27,6 +27,21 @@ namespace automation {
       }
       return bResult;
     }
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      bool bResult = children.empty();
+      for (Constraint *pConstraint : children) {
+        if (pConstraint->evaluate(ctx)) {
+          bResult = true;
+          if ( bShortCircuit ) {
+            break;
+          }
+        }
+      }
+      return bResult;
+    }
+    #endif
   };
 
 }
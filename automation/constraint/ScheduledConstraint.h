@@ -4,6 +4,10 @@
 #include "Constraint.h"
 #include "BooleanConstraint.h"
 #include "NestedConstraint.h"
+#include "LocalTime.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#endif
 #include <ctime>
 #include <vector>
 
@@ -17,36 +21,68 @@ namespace automation {
   public:
     RTTI_GET_TYPE_IMPL(automation,Scheduled)
 
-    struct RangeVector : public vector<pair<uint16_t,uint16_t>> {
-      int *pMember;
-      RangeVector(int* pMember) : pMember(pMember) {
+    // Allowed values of one struct tm field compiled from ranges into a bit set.  No ranges allows every value.
+    template<uint16_t MinVal, uint16_t MaxVal>
+    struct UnitMask {
+      static const uint16_t WordCnt = MaxVal/32+1;
+      uint32_t words[WordCnt];
+      bool bAll;
+
+      UnitMask() {
+        clear();
       }
 
-      RangeVector& operator=(const vector<pair<uint16_t,uint16_t>>& rhs) {
-        vector<pair<uint16_t,uint16_t>>::operator=(rhs);
+      UnitMask& operator=(const vector<pair<uint16_t,uint16_t>>& ranges) {
+        clear();
+        for ( auto range : ranges ) {
+          for ( uint16_t val = range.first; val <= range.second && val <= MaxVal; val++ ) {
+            words[val>>5] |= 1UL << (val&31);
+          }
+        }
+        bAll = ranges.empty() || isFull();
         return *this;
       }
 
-      bool check() {
-        int val = *pMember;
-        for ( auto range : *this ) {
-          if ( val >= range.first && val <= range.second )
-            return true;
+      bool check(int val) const {
+        return bAll || (val >= 0 && val <= MaxVal && (words[val>>5] >> (val&31)) & 1);
+      }
+
+      // smallest allowed value >= val or -1 if none
+      int next(int val) const {
+        for ( ; val <= MaxVal; val++ ) {
+          if ( check(val) ) {
+            return val;
+          }
         }
-        return empty();
+        return -1;
       }
-    };
 
-    struct tm checkTime;
+      void clear() {
+        for ( uint16_t i = 0; i < WordCnt; i++ ) {
+          words[i] = 0;
+        }
+        bAll = true;
+      }
 
-    RangeVector seconds = { &checkTime.tm_sec };
-    RangeVector minutes = { &checkTime.tm_min };
-    RangeVector hours = { &checkTime.tm_hour };
-    RangeVector weekDays = { &checkTime.tm_wday };
-    RangeVector monthDays = { &checkTime.tm_mday };
-    RangeVector months = { &checkTime.tm_mon };
-    RangeVector years = { &checkTime.tm_year };
-    vector<RangeVector*> rangeVectorList = { &years, &months, &monthDays, &weekDays, &hours, &minutes, &seconds };
+    protected:
+      bool isFull() const {
+        for ( uint16_t val = MinVal; val <= MaxVal; val++ ) {
+          if ( !((words[val>>5] >> (val&31)) & 1) ) {
+            return false;
+          }
+        }
+        return true;
+      }
+    };
+
+    // years are struct tm years (since 1900)
+    UnitMask<0,59> seconds;
+    UnitMask<0,59> minutes;
+    UnitMask<0,23> hours;
+    UnitMask<0,6> weekDays;
+    UnitMask<1,31> monthDays;
+    UnitMask<0,11> months;
+    UnitMask<0,255> years;
 
     ScheduledConstraint(Constraint *pConstraint = &automation::PASS_CONSTRAINT) :
         NestedConstraint(pConstraint) {
@@ -56,18 +92,130 @@ namespace automation {
       return bInnerCheckResult ? checkRanges() : false;
     }
 
-    bool checkRanges() {
+    bool checkRanges() const {
       if ( !automation::isTimeValid() ) {
         return false; // for arduino when no time hardware and time never set
       }
-      time_t now = std::time(nullptr);
-      checkTime = *localtime(&now);
-      for( auto unitRanges : rangeVectorList) {
-        if ( !unitRanges->check() ) {
-          return false;
+      return checkRanges(LocalTime::now());
+    }
+
+    bool checkRanges(const struct tm& t) const {
+      return seconds.check(t.tm_sec) && minutes.check(t.tm_min) && hours.check(t.tm_hour) && checkDay(t)
+          && months.check(t.tm_mon) && years.check(t.tm_year);
+    }
+
+    // Time the schedule next changes between matching and not matching (inner constraint not considered).
+    // Returns 0 if the schedule never changes.
+    time_t nextTransition(time_t now) const {
+      return checkRanges(LocalTime::get(now)) ? nextMismatch(now) : nextMatch(now);
+    }
+
+    // first time >= from that matches or 0 if none
+    time_t nextMatch(time_t from) const {
+      struct tm t = LocalTime::get(from);
+      for ( int i = 0; i < MAX_SEARCH_STEPS; i++ ) {
+        int val;
+        if ( !years.check(t.tm_year) ) {
+          if ( (val = years.next(t.tm_year)) < 0 ) {
+            return 0;
+          }
+          t.tm_year = val;
+          t.tm_mon = 0;
+          t.tm_mday = 1;
+          t.tm_hour = t.tm_min = t.tm_sec = 0;
+        } else if ( !months.check(t.tm_mon) ) {
+          if ( (val = months.next(t.tm_mon)) < 0 ) {
+            t.tm_year++;
+            val = 0;
+          }
+          t.tm_mon = val;
+          t.tm_mday = 1;
+          t.tm_hour = t.tm_min = t.tm_sec = 0;
+        } else if ( !checkDay(t) ) {
+          t.tm_mday++;
+          t.tm_hour = t.tm_min = t.tm_sec = 0;
+        } else if ( !hours.check(t.tm_hour) ) {
+          if ( (val = hours.next(t.tm_hour)) < 0 ) {
+            t.tm_mday++;
+            val = 0;
+          }
+          t.tm_hour = val;
+          t.tm_min = t.tm_sec = 0;
+        } else if ( !minutes.check(t.tm_min) ) {
+          if ( (val = minutes.next(t.tm_min)) < 0 ) {
+            t.tm_hour++;
+            val = 0;
+          }
+          t.tm_min = val;
+          t.tm_sec = 0;
+        } else if ( !seconds.check(t.tm_sec) ) {
+          if ( (val = seconds.next(t.tm_sec)) < 0 ) {
+            t.tm_min++;
+            val = 0;
+          }
+          t.tm_sec = val;
+        } else {
+          return normalize(t);
+        }
+        normalize(t);
+      }
+      return 0;
+    }
+
+    // first time > from that does not match or 0 if none.  Steps by the finest restricted unit since the
+    // result can only change at its boundaries.
+    time_t nextMismatch(time_t from) const {
+      struct tm t = LocalTime::get(from);
+      for ( int i = 0; i < MAX_SEARCH_STEPS; i++ ) {
+        if ( !seconds.bAll ) {
+          t.tm_sec++;
+        } else if ( !minutes.bAll ) {
+          t.tm_sec = 0;
+          t.tm_min++;
+        } else if ( !hours.bAll ) {
+          t.tm_sec = t.tm_min = 0;
+          t.tm_hour++;
+        } else if ( !weekDays.bAll || !monthDays.bAll ) {
+          t.tm_sec = t.tm_min = t.tm_hour = 0;
+          t.tm_mday++;
+        } else if ( !months.bAll ) {
+          t.tm_sec = t.tm_min = t.tm_hour = 0;
+          t.tm_mday = 1;
+          t.tm_mon++;
+        } else if ( !years.bAll ) {
+          t.tm_sec = t.tm_min = t.tm_hour = 0;
+          t.tm_mday = 1;
+          t.tm_mon = 0;
+          t.tm_year++;
+        } else {
+          return 0;
+        }
+        time_t next = normalize(t);
+        if ( !checkRanges(t) ) {
+          return next;
         }
       }
-      return true;
+      return 0;
+    }
+
+    #ifndef ARDUINO_APP
+    bool outerEvaluateValue(bool bInnerCheckResult, EvaluationContext& ctx) const override {
+      return bInnerCheckResult ? checkRanges(LocalTime::get(ctx.now)) : false;
+    }
+    #endif
+
+  protected:
+    // enough to step through every day of a few years (search gives up after that)
+    static const int MAX_SEARCH_STEPS = 1500;
+
+    bool checkDay(const struct tm& t) const {
+      return weekDays.check(t.tm_wday) && monthDays.check(t.tm_mday);
+    }
+
+    // mktime fixes out of range fields (hour 24, day 32...) and recomputes weekday
+    static time_t normalize(struct tm& t) {
+      t.tm_isdst = -1;
+      return mktime(&t);
     }
   };
 }
@@ -3,6 +3,10 @@
 
 #include "Constraint.h"
 #include "../capability/Capability.h"
+#include "StartCoordinator.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#endif
 
 #include <algorithm>
 
@@ -18,7 +22,24 @@ class SimultaneousConstraint : public Constraint, public Capability::CapabilityL
       maxIntervalMs(maxIntervalMs), pCapability(pCapability), targetValue(targetValue){
     }
 
+    // Let a StartCoordinator shared by the group decide instead of listening to every other capability.
+    // Requests count as ready (can hold back lower priority devices) only while all prerequisites passed.
+    SimultaneousConstraint& setCoordinator(StartCoordinator* pCoordinator, int priority = 0, const vector<Constraint*>& prerequisites = {}) {
+      this->pCoordinator = pCoordinator;
+      this->priority = priority;
+      this->prerequisites = prerequisites;
+      pCoordinator->add(pCapability);
+      return *this;
+    }
+
     bool checkValue() override {
+      if ( pCoordinator ) {
+        if ( pCapability->getValue() == targetValue ) {
+          pCoordinator->cancelRequest(pCapability);
+          return false;
+        }
+        return !pCoordinator->requestStart(pCapability, priority, maxIntervalMs, isReady(), millisecs());
+      }
       unsigned long now = millisecs();
       unsigned long elapsedMs = now - lastPassTimeMs;
       bool bLastPassRecent = elapsedMs <= maxIntervalMs;
@@ -34,12 +55,27 @@ class SimultaneousConstraint : public Constraint, public Capability::CapabilityL
       return false;
     }
 
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      if ( pCoordinator ) {
+        return ctx.getValue(*pCapability) != targetValue && !pCoordinator->canStart(pCapability, priority, maxIntervalMs, ctx.nowMs);
+      }
+      bool bLastPassRecent = ctx.nowMs - lastPassTimeMs <= maxIntervalMs;
+      return ctx.getValue(*pCapability) != targetValue 
+             && (!pLastPassCapability || ctx.getValue(*pLastPassCapability) == targetValue) 
+             && bLastPassRecent;
+    }
+    #endif
+
     string getTitle() const override {
         stringstream ss;
         string owner = pCapability->getOwnerName();
         ss << getType() << "(" << owner;
         size_t totalLength = owner.length();
-        for ( auto c : capabilityGroup ) {
+        for ( auto c : pCoordinator ? pCoordinator->capabilities : capabilityGroup ) {
+            if ( c == pCapability ) {
+                continue;
+            }
             owner = c->getOwnerName();
             const size_t maxTitleLen = 60;
             if ( totalLength + owner.length() > maxTitleLen ) {
@@ -82,6 +118,7 @@ class SimultaneousConstraint : public Constraint, public Capability::CapabilityL
       return *this;
     }
 
+    // Each constraint listens to every other capability in group (N*(N-1) listeners).  See setCoordinator().
     static void connectListeners( std::initializer_list<SimultaneousConstraint*> group) {
       for ( auto pConstraint : group ) {
         for ( auto pCapabilityOwner : group ) {
@@ -94,6 +131,13 @@ class SimultaneousConstraint : public Constraint, public Capability::CapabilityL
 
     virtual void printVerboseExtra(json::JsonStreamWriter& w) const override {
       w.printlnNumberObj(F("maxIntervalMs"),maxIntervalMs,",");
+      if ( pCoordinator ) {
+        unsigned long nowMs = millisecs();
+        w.printlnNumberObj(F("priority"),priority,",");
+        w.printlnNumberObj(F("waitingCnt"),(unsigned int)pCoordinator->waitingCount(nowMs),",");
+        w.printlnNumberObj(F("sinceLastStartMs"),nowMs-pCoordinator->lastStartMs(),",");
+        return;
+      }
       w.printlnNumberObj(F("remainingMs"), std::max((float)0,(float)maxIntervalMs-(float)(millisecs()-lastPassTimeMs)),",");
       w.printKey(F("capabilityIds"));
       w + F(" [");
@@ -115,6 +159,18 @@ class SimultaneousConstraint : public Constraint, public Capability::CapabilityL
     const Capability* pLastPassCapability = nullptr;
     vector<Capability*> capabilityGroup;
     double targetValue; // set to 1 if check for simultaneous toggle ON and set to 0 for toggle OFF
+    StartCoordinator* pCoordinator = nullptr;
+    int priority = 0;
+    vector<Constraint*> prerequisites;
+
+    bool isReady() const {
+      for ( auto pConstraint : prerequisites ) {
+        if ( !pConstraint->isPassed() ) {
+          return false;
+        }
+      }
+      return true;
+    }
   };
 
 }
@@ -0,0 +1,162 @@
+#ifndef AUTOMATION_START_COORDINATOR_H
+#define AUTOMATION_START_COORDINATOR_H
+
+#include "../capability/Capability.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace automation {
+
+  // Staggers starts of a group of loads (inrush current of HVAC compressors).  Each capability in the group is
+  // listened to once and recent starts are kept in a small ring.  A start is granted when the last start is at
+  // least minSpacingMs ago, fewer than maxInrush starts happened within inrushWindowMs and no ready requester with
+  // higher priority (or same priority and waiting longer) is queued.  Requests not refreshed within requestTtlMs
+  // are dropped so a device that stops asking does not block the group.
+  class StartCoordinator : public Capability::CapabilityListener {
+  public:
+
+    unsigned long minSpacingMs;
+    unsigned int maxInrush;
+    unsigned long inrushWindowMs;
+    unsigned long requestTtlMs;
+    float targetValue;
+
+    struct Request {
+      const Capability* pCapability;
+      int priority;
+      bool bReady;
+      unsigned long firstRequestMs, lastRequestMs;
+    };
+
+    vector<Capability*> capabilities;
+
+    StartCoordinator(unsigned long minSpacingMs, unsigned int maxInrush = 1, unsigned long inrushWindowMs = 0,
+                     unsigned long requestTtlMs = 60000, float targetValue = 1.0) :
+      minSpacingMs(minSpacingMs),
+      maxInrush(maxInrush),
+      inrushWindowMs(inrushWindowMs ? inrushWindowMs : minSpacingMs),
+      requestTtlMs(requestTtlMs),
+      targetValue(targetValue) {
+      for ( auto& start : starts ) {
+        start = {nullptr, 0};
+      }
+    }
+
+    void add(Capability* pCapability) {
+      if ( std::find(capabilities.begin(),capabilities.end(),pCapability) == capabilities.end() ) {
+        capabilities.push_back(pCapability);
+        pCapability->addListener(this);
+      }
+    }
+
+    // Refresh request of pCapability and return true if it may start now.  bReady is false when the requester
+    // would not start anyway (other constraints failing) so it does not hold back lower priority requesters.
+    bool requestStart(const Capability* pCapability, int priority, unsigned long spacingMs, bool bReady, unsigned long nowMs) {
+      Request* pRequest = findRequest(pCapability);
+      if ( !pRequest ) {
+        requests.push_back({pCapability, priority, bReady, nowMs, nowMs});
+        pRequest = &requests.back();
+      } else if ( nowMs - pRequest->lastRequestMs > requestTtlMs ) {
+        pRequest->firstRequestMs = nowMs;
+      }
+      pRequest->priority = priority;
+      pRequest->bReady = bReady;
+      pRequest->lastRequestMs = nowMs;
+      return canStart(pCapability, priority, spacingMs, nowMs);
+    }
+
+    void cancelRequest(const Capability* pCapability) {
+      for ( auto it = requests.begin(); it != requests.end(); it++ ) {
+        if ( it->pCapability == pCapability ) {
+          requests.erase(it);
+          break;
+        }
+      }
+    }
+
+    // Same decision as requestStart() without updating the queue
+    bool canStart(const Capability* pCapability, int priority, unsigned long spacingMs, unsigned long nowMs) const {
+      if ( spacingMs < minSpacingMs ) {
+        spacingMs = minSpacingMs;
+      }
+      unsigned int inrushCnt = 0;
+      for ( const Start& start : starts ) {
+        if ( !start.pCapability || start.pCapability == pCapability || start.pCapability->getValue() != targetValue ) {
+          continue; // starts of loads already turned off again do not count
+        }
+        unsigned long elapsedMs = nowMs - start.timeMs;
+        if ( elapsedMs < spacingMs ) {
+          return false;
+        }
+        if ( elapsedMs < inrushWindowMs ) {
+          inrushCnt++;
+        }
+      }
+      if ( inrushCnt >= maxInrush ) {
+        return false;
+      }
+      const Request* pOwnRequest = findRequest(pCapability);
+      unsigned long firstRequestMs = pOwnRequest ? pOwnRequest->firstRequestMs : nowMs;
+      for ( const Request& request : requests ) {
+        if ( request.pCapability == pCapability || !request.bReady || nowMs - request.lastRequestMs > requestTtlMs ) {
+          continue;
+        }
+        if ( request.priority > priority || (request.priority == priority && (long)(firstRequestMs - request.firstRequestMs) > 0) ) {
+          return false; // someone else is first in line
+        }
+      }
+      return true;
+    }
+
+    unsigned long lastStartMs() const {
+      const Start& start = starts[(nextStart + START_RING_SIZE - 1) % START_RING_SIZE];
+      return start.timeMs;
+    }
+
+    size_t waitingCount(unsigned long nowMs) const {
+      size_t cnt = 0;
+      for ( const Request& request : requests ) {
+        if ( request.bReady && nowMs - request.lastRequestMs <= requestTtlMs ) {
+          cnt++;
+        }
+      }
+      return cnt;
+    }
+
+    void valueSet(const Capability* pCapability, float newVal, float oldVal) override {
+      if ( newVal == oldVal || newVal != targetValue ) {
+        return;
+      }
+      starts[nextStart] = {pCapability, millisecs()};
+      nextStart = (nextStart + 1) % START_RING_SIZE;
+      cancelRequest(pCapability);
+    }
+
+  protected:
+    static const unsigned int START_RING_SIZE = 8;
+
+    struct Start {
+      const Capability* pCapability;
+      unsigned long timeMs;
+    } starts[START_RING_SIZE];
+    unsigned int nextStart = 0;
+
+    vector<Request> requests;
+
+    const Request* findRequest(const Capability* pCapability) const {
+      for ( const Request& request : requests ) {
+        if ( request.pCapability == pCapability ) {
+          return &request;
+        }
+      }
+      return nullptr;
+    }
+
+    Request* findRequest(const Capability* pCapability) {
+      return const_cast<Request*>(static_cast<const StartCoordinator*>(this)->findRequest(pCapability));
+    }
+  };
+
+}
+#endif
@@ -0,0 +1,187 @@
+#ifndef AUTOMATION_STATIC_VALUE_CONSTRAINT_H
+#define AUTOMATION_STATIC_VALUE_CONSTRAINT_H
+
+#include "Constraint.h"
+#include "../text.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#endif
+
+#include <string>
+#include <math.h>
+
+using namespace std;
+
+namespace automation {
+
+  // Value constraints with the value source, comparator and validator as template parameters.  ValueConstraint
+  // goes through several virtual calls per test (checkValue, getValue, ValueHolder::getValue, isValid).  Here
+  // checkValue() is the only virtual call and the rest inlines into one comparison.
+  //
+  //   StaticValueConstraint<float,SensorSource<PrometheusSensor>,AtLeastComparator<float>> minVoltage{batteryBankVoltage, 24.5};
+  //
+
+  // Calls SensorT::getValue() without virtual dispatch.  SensorT should be the concrete sensor class.
+  template<typename SensorT>
+  struct SensorSource {
+    SensorT& sensor;
+    SensorSource(SensorT& sensor) : sensor(sensor) {}
+    float getValue() const { return sensor.SensorT::getValue(); }
+    #ifndef ARDUINO_APP
+    float getValue(EvaluationContext& ctx) const { return ctx.getValue(sensor); }
+    #endif
+    string getName() const { return sensor.name; }
+  };
+
+  template<typename ValueT, ValueT (*GetValueFn)()>
+  struct FunctionSource {
+    const char* pszName;
+    FunctionSource(const char* pszName) : pszName(pszName) {}
+    ValueT getValue() const { return GetValueFn(); }
+    #ifndef ARDUINO_APP
+    ValueT getValue(EvaluationContext& ctx) const { return GetValueFn(); }
+    #endif
+    string getName() const { return pszName; }
+  };
+
+  // Comparators get the margin to tighten bounds by (negative when failMargin is loosening a passed result)
+  template<typename ValueT>
+  struct AtLeastComparator {
+    ValueT minVal;
+    AtLeastComparator(ValueT minVal) : minVal(minVal) {}
+    bool operator()(ValueT value, ValueT margin) const { return value >= minVal + margin; }
+    bool setAttribute(const char* pszKey, const char* pszVal) {
+      if ( !strcasecmp_P(pszKey,PSTR("THRESHOLD")) ) {
+        minVal = atof(pszVal);
+        return true;
+      }
+      return false;
+    }
+    string getTitle() const { return string(" AtLeast(") + text::asString(minVal) + ")"; }
+    void printVerboseExtra(json::JsonStreamWriter& w) const { w.printlnNumberObj(F("threshold"),minVal,","); }
+  };
+
+  template<typename ValueT>
+  struct AtMostComparator {
+    ValueT maxVal;
+    AtMostComparator(ValueT maxVal) : maxVal(maxVal) {}
+    bool operator()(ValueT value, ValueT margin) const { return value <= maxVal - margin; }
+    bool setAttribute(const char* pszKey, const char* pszVal) {
+      if ( !strcasecmp_P(pszKey,PSTR("THRESHOLD")) ) {
+        maxVal = atof(pszVal);
+        return true;
+      }
+      return false;
+    }
+    string getTitle() const { return string(" AtMost(") + text::asString(maxVal) + ")"; }
+    void printVerboseExtra(json::JsonStreamWriter& w) const { w.printlnNumberObj(F("threshold"),maxVal,","); }
+  };
+
+  template<typename ValueT>
+  struct RangeComparator {
+    ValueT minVal, maxVal;
+    RangeComparator(ValueT minVal, ValueT maxVal) : minVal(minVal), maxVal(maxVal) {}
+    bool operator()(ValueT value, ValueT margin) const { return value >= minVal + margin && value <= maxVal - margin; }
+    bool setAttribute(const char* pszKey, const char* pszVal) {
+      if ( !strcasecmp_P(pszKey,PSTR("minVal")) ) {
+        minVal = atof(pszVal);
+        return true;
+      } else if ( !strcasecmp_P(pszKey,PSTR("maxVal")) ) {
+        maxVal = atof(pszVal);
+        return true;
+      }
+      return false;
+    }
+    string getTitle() const { return string(" Range(") + text::asString(minVal) + "," + text::asString(maxVal) + ")"; }
+    void printVerboseExtra(json::JsonStreamWriter& w) const {
+      w.printlnNumberObj(F("minVal"),minVal,",");
+      w.printlnNumberObj(F("maxVal"),maxVal,",");
+    }
+  };
+
+  template<typename ValueT>
+  struct AcceptAllValidator {
+    bool isValid(ValueT value) const { return true; }
+    bool getPassOnInvalid() const { return false; }
+  };
+
+  // Sensors report NAN when a read fails
+  template<typename ValueT, bool bPassOnInvalid = false>
+  struct NotNanValidator {
+    bool isValid(ValueT value) const { return !isnan(value); }
+    bool getPassOnInvalid() const { return bPassOnInvalid; }
+  };
+
+  template<typename ValueT, typename SourceT, typename ComparatorT, typename ValidatorT = AcceptAllValidator<ValueT>>
+  class StaticValueConstraint final : public Constraint {
+  public:
+    RTTI_GET_TYPE_IMPL(automation,StaticValue)
+
+    SourceT source;
+    ComparatorT comparator;
+    ValidatorT validator;
+
+    StaticValueConstraint(SourceT source, ComparatorT comparator, ValidatorT validator = ValidatorT()) :
+      source(source), comparator(comparator), validator(validator) {
+    }
+
+    bool checkValue() override {
+      const ValueT value = source.getValue();
+      if ( !validator.isValid(value) ) {
+        return validator.getPassOnInvalid();
+      }
+      return comparator(value, margin(deferredTimeMs != 0, isPassed()));
+    }
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      const ValueT value = source.getValue(ctx);
+      if ( !validator.isValid(value) ) {
+        return validator.getPassOnInvalid();
+      }
+      const EvaluationState& state = evaluationState(ctx);
+      return comparator(value, margin(state.deferredTimeMs != 0, state.bPassed));
+    }
+    #endif
+
+    string getTitle() const override {
+      return source.getName() + comparator.getTitle();
+    }
+
+    void printVerboseExtra(json::JsonStreamWriter& w) const override {
+      w.printlnStringObj(F("valueSource"),source.getName().c_str(),",");
+      comparator.printVerboseExtra(w);
+    }
+
+    SetCode setAttribute(const char* pszKey, const char* pszVal, ostream* pRespStream = nullptr) override {
+      SetCode rtn = Constraint::setAttribute(pszKey,pszVal,pRespStream);
+      if ( rtn == SetCode::Ignored && comparator.setAttribute(pszKey,pszVal) ) {
+        rtn = SetCode::OK;
+        if ( pRespStream ) {
+          (*pRespStream) << "'" << getTitle() << "' " << pszKey << "=" << pszVal;
+        }
+      }
+      return rtn;
+    }
+
+  protected:
+    // margins only apply after the first test and which one applies depends on the current result
+    ValueT margin(bool bApplyMargins, bool bPassed) const {
+      if ( !bApplyMargins ) {
+        return 0;
+      }
+      return bPassed ? -failMargin : passMargin;
+    }
+  };
+
+  template<typename SensorT, typename ValidatorT = AcceptAllValidator<float>>
+  using SensorAtLeast = StaticValueConstraint<float,SensorSource<SensorT>,AtLeastComparator<float>,ValidatorT>;
+
+  template<typename SensorT, typename ValidatorT = AcceptAllValidator<float>>
+  using SensorAtMost = StaticValueConstraint<float,SensorSource<SensorT>,AtMostComparator<float>,ValidatorT>;
+
+  template<typename SensorT, typename ValidatorT = AcceptAllValidator<float>>
+  using SensorRange = StaticValueConstraint<float,SensorSource<SensorT>,RangeComparator<float>,ValidatorT>;
+
+}
+#endif
@@ -3,6 +3,10 @@
 
 #include "Constraint.h"
 #include "BooleanConstraint.h"
+#include "LocalTime.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#endif
 #include <ctime>
 #include <vector>
 #include <sstream>
@@ -32,28 +36,61 @@ namespace automation {
       return os;            
     }
 
+    // Range is inclusive and wraps past midnight if endTime is before beginTime (22:00-06:00)
     TimeRangeConstraint(Time beginTime, Time endTime) :
         beginTime(beginTime),
-        endTime(endTime) {
+        endTime(endTime),
+        beginSecond(secondsOfDay(beginTime)),
+        endSecond(secondsOfDay(endTime)) {
     }
 
     bool checkValue() override {
       if ( !automation::isTimeValid() ) {
         return false; // for arduino when no time hardware and time never set
       }
-      time_t now = std::time(nullptr);
-      struct tm checkTime = *localtime(&now);
-      struct tm beginTm = checkTime, endTm = checkTime;
-      beginTm.tm_hour = beginTime.hour;
-      beginTm.tm_min = beginTime.minute;
-      beginTm.tm_sec = beginTime.second;
-      endTm.tm_hour = endTime.hour;
-      endTm.tm_min = endTime.minute;
-      endTm.tm_sec = endTime.second;
-      now = mktime(&checkTime);
-      time_t beginTimeT = mktime(&beginTm);
-      time_t endTimeT = mktime(&endTm);
-      return now >= beginTimeT && now <= endTimeT;
+      return isInRange(std::time(nullptr));
+    }
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      return isInRange(ctx.now);
+    }
+    #endif
+
+    // compares wall clock seconds of day so a range keeps its local times across DST changes
+    bool isInRange(time_t now) const {
+      return isSecondInRange(LocalTime::secondsOfDay(LocalTime::get(now)));
+    }
+
+    bool isSecondInRange(long second) const {
+      if ( beginSecond <= endSecond ) {
+        return second >= beginSecond && second <= endSecond;
+      }
+      return second >= beginSecond || second <= endSecond;
+    }
+
+    // true if no second of the day is outside the range (23:00-22:59:59 wraps around to cover it all)
+    bool isWholeDay() const {
+      long secondCnt = beginSecond <= endSecond ? endSecond - beginSecond + 1 : LocalTime::SECONDS_PER_DAY - beginSecond + endSecond + 1;
+      return secondCnt >= LocalTime::SECONDS_PER_DAY;
+    }
+
+    // Next time after now that the result changes or 0 if range is the whole day
+    time_t nextBoundary(time_t now) const {
+      if ( isWholeDay() ) {
+        return 0;
+      }
+      struct tm t = LocalTime::get(now);
+      long second = LocalTime::secondsOfDay(t);
+      long boundarySecond = isSecondInRange(second) ? endSecond + 1 : beginSecond;
+      if ( boundarySecond <= second ) {
+        t.tm_mday++;
+      }
+      t.tm_hour = boundarySecond / 3600;
+      t.tm_min = boundarySecond / 60 % 60;
+      t.tm_sec = boundarySecond % 60;
+      t.tm_isdst = -1;
+      return mktime(&t);
     }
 
     string getTitle() const override {
@@ -70,6 +107,13 @@ namespace automation {
       w.printlnStringObj(F("beginTime"),timeAsString(beginTime),",");
       w.printlnStringObj(F("endTime"),timeAsString(endTime),",");
     }
+
+  protected:
+    long beginSecond, endSecond;
+
+    static long secondsOfDay(const Time& t) {
+      return t.hour*3600L + t.minute*60L + t.second;
+    }
   };
 
 }
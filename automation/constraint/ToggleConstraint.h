@@ -3,6 +3,9 @@
 
 #include "Constraint.h"
 #include "../capability/Toggle.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#endif
 
 namespace automation {
 
@@ -23,6 +26,12 @@ namespace automation {
       return pToggle->asBoolean() == bAcceptState;
     }
 
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      return (ctx.getValue(*pToggle) != 0) == bAcceptState;
+    }
+    #endif
+
     string getTitle() const override {
       string title = pToggle->getTitle();
       title += "==";
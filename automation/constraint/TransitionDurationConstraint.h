@@ -3,6 +3,9 @@
 
 #include "Constraint.h"
 #include "../capability/Capability.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#endif
 #include <sstream>
 #include <math.h>
 
@@ -39,6 +42,17 @@ class TransitionDurationConstraint : public Constraint {
       return bValuePassedForDuration;
     }
 
+    #ifndef ARDUINO_APP
+    // same as checkValue() without remembering the value or state start time
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      if ( ctx.getValue(*pCapability) == destinationValue ) {
+        return true;
+      }
+      unsigned long startTimeMs = originValue != lastValue ? ctx.nowMs : stateStartTimeMs;
+      return ctx.nowMs - startTimeMs >= minIntervalMs;
+    }
+    #endif
+
     string getTitle() const override {
       stringstream ss;
       ss << "TransitionDuration(" << minIntervalMs << ',' << pCapability->getTitle() << " " << originValue << F("-->") << destinationValue << ")";
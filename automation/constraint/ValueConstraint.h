@@ -3,14 +3,30 @@
 
 #include "Constraint.h"
 #include "../text.h"
+#ifndef ARDUINO_APP
+#include "EvaluationContext.h"
+#include "ComparisonCache.h"
+#endif
 
 #include <string>
+#include <limits>
 
 using namespace std;
 
 namespace automation {
 
   
+  // open ended bounds for AtLeast/AtMost (infinity keeps float sensors reporting inf passing as before)
+  template<typename ValueT>
+  ValueT lowestValue() {
+    return std::numeric_limits<ValueT>::has_infinity ? -std::numeric_limits<ValueT>::infinity() : std::numeric_limits<ValueT>::lowest();
+  }
+
+  template<typename ValueT>
+  ValueT highestValue() {
+    return std::numeric_limits<ValueT>::has_infinity ? std::numeric_limits<ValueT>::infinity() : std::numeric_limits<ValueT>::max();
+  }
+
   template<typename ValueT> 
   struct ValueValidator {
     virtual bool isValid(const ValueT &val) const { return true; }
@@ -28,6 +44,11 @@ namespace automation {
     ValueValidator<ValueT>* pValueValidator{ nullptr };
 
     bool checkValue() override {
+      #ifndef ARDUINO_APP
+      if ( ComparisonCache::instance.isActive() ) {
+        return checkValue(ComparisonCache::instance);
+      }
+      #endif
       const ValueT &value = getValue();
       if ( pValueValidator && !pValueValidator->isValid(value) ) {
         return pValueValidator->getPassOnInvalid();
@@ -40,7 +61,60 @@ namespace automation {
       return valueSource.getValue();
     }
 
-    virtual bool checkValue(const ValueT &val) = 0;
+    virtual bool checkValue(const ValueT &val) {
+      return compare(val, this->deferredTimeMs != 0, this->isPassed());
+    }
+
+    // Range of values that pass allowing for pass/fail margins.  Margins only apply after the first test (bApplyMargins)
+    // and which one applies depends on the current result (bPassed).
+    virtual void getBounds(ValueT &minVal, ValueT &maxVal, bool bApplyMargins, bool bPassed) const = 0;
+
+    bool compare(const ValueT &val, bool bApplyMargins, bool bPassed) const {
+      ValueT minVal, maxVal;
+      getBounds(minVal, maxVal, bApplyMargins, bPassed);
+      return val >= minVal && val <= maxVal;
+    }
+
+    #ifndef ARDUINO_APP
+    // Constraints with the same value source, validator and bounds share one comparison per tick
+    bool checkValue(ComparisonCache& cache) {
+      ValueT minVal, maxVal;
+      getBounds(minVal, maxVal, this->deferredTimeMs != 0, this->isPassed());
+      const ComparisonCache::Entry* pEntry = cache.find(&valueSource, pValueValidator, minVal, maxVal);
+      if ( pEntry ) {
+        return pEntry->bResult;
+      }
+      double cachedValue;
+      if ( !cache.findValue(&valueSource, cachedValue) ) {
+        cachedValue = getValue();
+        cache.addValue(&valueSource, cachedValue);
+      }
+      const ValueT value = cachedValue;
+      bool bResult;
+      if ( pValueValidator && !pValueValidator->isValid(value) ) {
+        bResult = pValueValidator->getPassOnInvalid();
+      } else {
+        bResult = value >= minVal && value <= maxVal;
+      }
+      cache.add(&valueSource, pValueValidator, minVal, maxVal, bResult);
+      return bResult;
+    }
+    #endif
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      const ValueT value = getValue(ctx);
+      if ( pValueValidator && !pValueValidator->isValid(value) ) {
+        return pValueValidator->getPassOnInvalid();
+      }
+      const EvaluationState& state = this->evaluationState(ctx);
+      return compare(value, state.deferredTimeMs != 0, state.bPassed);
+    }
+
+    virtual ValueT getValue(EvaluationContext& ctx) const {
+      return ctx.getValue(valueSource);
+    }
+    #endif
 
     void printValueSourceObj(json::JsonStreamWriter& w,const char* pszKey, const char* pszSeparator = "") const {
       w.printKey(pszKey);
@@ -101,12 +175,12 @@ namespace automation {
       w.printlnNumberObj(F("maxVal"),maxVal,",");
     }
 
-    bool checkValue(const ValueT &value) override {
-      ValueT minVal = this->minVal;
-      ValueT maxVal = this->maxVal;
+    void getBounds(ValueT &minVal, ValueT &maxVal, bool bApplyMargins, bool bPassed) const override {
+      minVal = this->minVal;
+      maxVal = this->maxVal;
 
-      if (this->deferredTimeMs) {
-        if (this->isPassed()) {
+      if (bApplyMargins) {
+        if (bPassed) {
           minVal -= this->failMargin;
           maxVal += this->failMargin;
         } else {
@@ -114,8 +188,6 @@ namespace automation {
           maxVal -= this->passMargin;
         }
       }
-
-      return value >= minVal && value <= maxVal;
     }
 
     SetCode setAttribute(const char* pszKey, const char* pszVal, ostream* pRespStream = nullptr) override {
@@ -184,6 +256,25 @@ namespace automation {
       return rtn;
     }
 
+    void getBounds(ValueT &minVal, ValueT &maxVal, bool bApplyMargins, bool bPassed) const override {
+      getBounds(pThreshold->getValue(), minVal, maxVal, bApplyMargins, bPassed);
+    }
+
+    virtual void getBounds(ValueT threshold, ValueT &minVal, ValueT &maxVal, bool bApplyMargins, bool bPassed) const = 0;
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      const ValueT value = this->getValue(ctx);
+      if ( this->pValueValidator && !this->pValueValidator->isValid(value) ) {
+        return this->pValueValidator->getPassOnInvalid();
+      }
+      const EvaluationState& state = this->evaluationState(ctx);
+      ValueT minVal, maxVal;
+      getBounds(ctx.getValue(*pThreshold), minVal, maxVal, state.deferredTimeMs != 0, state.bPassed);
+      return value >= minVal && value <= maxVal;
+    }
+    #endif
+
     virtual ~ThresholdValueConstraint() {
       if ( bDeleteThreshold ) {        
         delete pThreshold;
@@ -236,18 +327,16 @@ namespace automation {
         : ThresholdValueConstraint<ValueT,ValueSourceT>(new ConstantValueHolder<ValueT>(threshold),valueSource) {
     }
 
-    bool checkValue(const ValueT &value) override {
-      ValueT maxVal = this->pThreshold->getValue();
-
-      if (this->deferredTimeMs) {
-        if (this->isPassed()) {
+    void getBounds(ValueT threshold, ValueT &minVal, ValueT &maxVal, bool bApplyMargins, bool bPassed) const override {
+      minVal = lowestValue<ValueT>();
+      maxVal = threshold;
+      if (bApplyMargins) {
+        if (bPassed) {
           maxVal += this->failMargin;
         } else {
           maxVal -= this->passMargin;
         }
       }
-
-      return value <= maxVal;
     }
   };
 
@@ -264,17 +353,16 @@ namespace automation {
         : ThresholdValueConstraint<ValueT,ValueSourceT>(new ConstantValueHolder<ValueT>(threshold),valueSource,true) {
     }
 
-    bool checkValue(const ValueT &value) override {
-      ValueT minVal = this->pThreshold->getValue();
-
-      if (this->deferredTimeMs) {
-        if (this->isPassed()) {
+    void getBounds(ValueT threshold, ValueT &minVal, ValueT &maxVal, bool bApplyMargins, bool bPassed) const override {
+      minVal = threshold;
+      maxVal = highestValue<ValueT>();
+      if (bApplyMargins) {
+        if (bPassed) {
           minVal -= this->failMargin;
         } else {
           minVal += this->passMargin;
         }
       }
-      return value >= minVal;
     }
   };
 
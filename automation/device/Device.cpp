@@ -57,6 +57,16 @@ void Device::print(json::JsonStreamWriter& w, bool bVerbose, bool bIncludePrefix
     w.printlnVectorObj(F("capabilities"), capabilities,",", bVerbose);
     printVerboseExtra(w);
   }    
+  #ifndef ARDUINO_APP
+  w.printKey(F("breaker"));
+  w.noPrefixPrintln("{");
+  w.increaseDepth();
+  w.printlnStringObj(F("state"),breaker.getStateName(),",");
+  w.printlnNumberObj(F("failures"),breaker.getFailureCount(),",");
+  w.printlnNumberObj(F("retryInMs"),breaker.getRetryInMs());
+  w.decreaseDepth();
+  w.println("},");
+  #endif
   w.printlnStringObj(F("type"),getType());    
   w.decreaseDepth();
   w.print("}");
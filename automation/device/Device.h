@@ -4,6 +4,9 @@
 #include "../json/JsonStreamWriter.h"
 #include "../constraint/Constraint.h"
 #include "../AttributeContainer.h"
+#ifndef ARDUINO_APP
+#include "../CircuitBreaker.h"
+#endif
 
 #include <vector>
 #include <string>
@@ -20,6 +23,9 @@ namespace automation {
 
     vector<Capability *> capabilities;
     mutable bool bError;
+    #ifndef ARDUINO_APP
+    CircuitBreaker breaker; // skips the device while it keeps failing (bError)
+    #endif
 
     Device(const string &name) :
         NamedContainer(name), bError(false) {
@@ -43,8 +49,8 @@ namespace automation {
     }
 
     virtual void setConstraint(Constraint* pConstraint) {
-      if ( pConstraint ) {
-        pConstraint->listeners.remove(this);
+      if ( this->pConstraint ) {
+        this->pConstraint->listeners.remove(this);
       }
       this->pConstraint = pConstraint;
       this->pConstraint->listeners.add(this);
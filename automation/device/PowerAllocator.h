@@ -0,0 +1,221 @@
+#ifndef AUTOMATION_POWER_ALLOCATOR_H
+#define AUTOMATION_POWER_ALLOCATOR_H
+
+#include "PowerSwitch.h"
+#include "../constraint/Constraint.h"
+#ifndef ARDUINO_APP
+#include "../constraint/EvaluationContext.h"
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+namespace automation {
+
+  // Decides once per tick which switches share the surplus power instead of each device deciding on its own and
+  // rotating the device list for fairness.  Loads that want to run (their own constraint passed) are filled
+  // greedily by priority then rotation credit.  Credit grows while a load waits and shrinks while it runs so loads
+  // of the same priority take turns.  Minimum on/off times are honored unless the battery is below minVoltage.
+  class PowerAllocator : public Capability::CapabilityListener {
+  public:
+
+    struct BatteryState {
+      float soc;
+      float voltage;
+    };
+
+    struct Load {
+      PowerSwitch* pSwitch;
+      const Constraint* pWant;
+      int priority;
+      unsigned long minOnMs, minOffMs;
+      bool bOn, bAllocated;
+      unsigned long changeTimeMs;
+      long creditMs;
+    };
+
+    float minVoltage = 0;               // allocate nothing below this voltage
+    float fullSoc = 100;                // battery may add batteryAllowanceWatts at or above this soc
+    float batteryAllowanceWatts = 0;
+    float reserveWatts = 0;             // surplus kept unallocated
+    long maxCreditMs = 30*60*1000L;     // bounds how far a load can fall behind or get ahead
+
+    std::vector<Load> loads;
+
+    // what allocate() is given each tick (input power, soc and battery voltage).  Optional, lets AllocationConstraint
+    // answer "what if" questions from the context's values instead of reporting the live allocation.
+    const ValueHolder<float>* pInputWatts = nullptr;
+    const ValueHolder<float>* pSoc = nullptr;
+    const ValueHolder<float>* pVoltage = nullptr;
+
+    // pWant is the load's own constraint (allocation only goes to loads that want to run)
+    Load& add(PowerSwitch* pSwitch, const Constraint* pWant, int priority = 0, unsigned long minOnMs = 0, unsigned long minOffMs = 0) {
+      loads.push_back({pSwitch, pWant, priority, minOnMs, minOffMs, pSwitch->isOn(), false, millisecs(), 0});
+      pSwitch->toggle.addListener(this);
+      order.reserve(loads.size());
+      allocated.reserve(loads.size());
+      return loads.back();
+    }
+
+    void allocate(float inputWatts, const BatteryState& battery, unsigned long nowMs) {
+      unsigned long elapsedMs = lastAllocateMs ? nowMs - lastAllocateMs : 0;
+      lastAllocateMs = nowMs;
+
+      // rotation credit
+      for ( Load& load : loads ) {
+        bool bWant = load.pWant ? load.pWant->isPassed() : true;
+        if ( load.bOn ) {
+          load.creditMs = std::max(load.creditMs - (long) elapsedMs, -maxCreditMs);
+        } else if ( bWant ) {
+          load.creditMs = std::min(load.creditMs + (long) elapsedMs, maxCreditMs);
+        }
+      }
+      unallocatedWatts = fill(inputWatts, battery, nowMs,
+                              [](const Load& load) { return load.pWant ? load.pWant->isPassed() : true; },
+                              [](const Load& load) { return load.bOn; },
+                              order, allocated);
+      for ( size_t i = 0; i < loads.size(); i++ ) {
+        loads[i].bAllocated = allocated[i];
+      }
+    }
+
+    bool isAllocated(const Device* pDevice) const {
+      const Load* pLoad = find(pDevice);
+      return pLoad && pLoad->bAllocated;
+    }
+
+    float getUnallocatedWatts() const { return unallocatedWatts; }
+
+    #ifndef ARDUINO_APP
+    // Allocation with the context's input power, battery, load constraints and switch states.  Rotation credit and
+    // on/off times are the live ones and nothing is changed.  Live allocation if the sources were not set.
+    bool isAllocated(const Device* pDevice, EvaluationContext& ctx) const {
+      const Load* pLoad = find(pDevice);
+      if ( !pLoad ) {
+        return false;
+      }
+      if ( !pInputWatts || !pSoc || !pVoltage ) {
+        return pLoad->bAllocated;
+      }
+      std::vector<const Load*> ctxOrder;
+      std::vector<bool> ctxAllocated;
+      fill(ctx.getValue(*pInputWatts), {ctx.getValue(*pSoc), ctx.getValue(*pVoltage)}, ctx.nowMs,
+           [&ctx](const Load& load) { return load.pWant ? load.pWant->evaluate(ctx) : true; },
+           [&ctx](const Load& load) { return ctx.getValue(load.pSwitch->toggle) != 0; },
+           ctxOrder, ctxAllocated);
+      return ctxAllocated[pLoad - loads.data()];
+    }
+    #endif
+
+    // pick up switches changed remotely
+    void sync() {
+      for ( Load& load : loads ) {
+        bool bOn = load.pSwitch->isOnObserved();
+        if ( bOn != load.bOn ) {
+          load.bOn = bOn;
+          load.changeTimeMs = millisecs();
+        }
+      }
+    }
+
+    void valueSet(const Capability* pCapability, float newVal, float oldVal) override {
+      for ( Load& load : loads ) {
+        if ( &load.pSwitch->toggle == pCapability ) {
+          bool bOn = newVal != 0;
+          if ( bOn != load.bOn ) {
+            load.bOn = bOn;
+            load.changeTimeMs = millisecs();
+          }
+          break;
+        }
+      }
+    }
+
+  protected:
+    std::vector<const Load*> order;
+    std::vector<bool> allocated;
+    unsigned long lastAllocateMs = 0;
+    float unallocatedWatts = 0;
+
+    // One allocation pass over the loads (isWant and isOn give each load's constraint result and switch state).
+    // Sets allocated by load index and returns the watts left over.
+    template<typename WantFn, typename OnFn>
+    float fill(float inputWatts, const BatteryState& battery, unsigned long nowMs, WantFn isWant, OnFn isOn,
+               std::vector<const Load*>& order, std::vector<bool>& allocated) const {
+      float availableWatts = isnan(inputWatts) ? 0 : inputWatts - reserveWatts;
+      if ( battery.soc >= fullSoc ) {
+        availableWatts += batteryAllowanceWatts;
+      }
+      order.clear();
+      allocated.assign(loads.size(), false);
+      if ( !isnan(battery.voltage) && battery.voltage < minVoltage ) {
+        return availableWatts; // shed
+      }
+      for ( size_t i = 0; i < loads.size(); i++ ) {
+        const Load& load = loads[i];
+        bool bOn = isOn(load);
+        unsigned long stateMs = nowMs - load.changeTimeMs;
+        if ( bOn && stateMs < load.minOnMs ) {
+          allocated[i] = true; // must keep running
+          availableWatts -= load.pSwitch->requiredWatts;
+        } else if ( isWant(load) && (bOn || stateMs >= load.minOffMs) ) {
+          order.push_back(&load);
+        }
+      }
+
+      std::sort(order.begin(), order.end(), [](const Load* pLhs, const Load* pRhs) {
+        if ( pLhs->priority != pRhs->priority ) {
+          return pLhs->priority > pRhs->priority;
+        }
+        return pLhs->creditMs > pRhs->creditMs;
+      });
+
+      for ( const Load* pLoad : order ) {
+        if ( pLoad->pSwitch->requiredWatts <= availableWatts ) {
+          allocated[pLoad - loads.data()] = true;
+          availableWatts -= pLoad->pSwitch->requiredWatts;
+        }
+      }
+      return availableWatts;
+    }
+
+    const Load* find(const Device* pDevice) const {
+      for ( const Load& load : loads ) {
+        if ( load.pSwitch == pDevice ) {
+          return &load;
+        }
+      }
+      return nullptr;
+    }
+  };
+
+  // Passes while the allocator has given the device its power
+  class AllocationConstraint : public Constraint {
+  public:
+    RTTI_GET_TYPE_IMPL(automation,Allocation)
+
+    const PowerAllocator* pAllocator;
+    const Device* pDevice;
+
+    AllocationConstraint(const PowerAllocator* pAllocator, const Device* pDevice) :
+      pAllocator(pAllocator), pDevice(pDevice) {
+    }
+
+    bool checkValue() override {
+      return pAllocator->isAllocated(pDevice);
+    }
+
+    #ifndef ARDUINO_APP
+    bool evaluateValue(EvaluationContext& ctx) const override {
+      return pAllocator->isAllocated(pDevice, ctx);
+    }
+    #endif
+
+    string getTitle() const override {
+      return getType() + "(" + pDevice->name + ")";
+    }
+  };
+
+}
+#endif
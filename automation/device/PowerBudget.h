@@ -0,0 +1,174 @@
+#ifndef AUTOMATION_POWER_BUDGET_H
+#define AUTOMATION_POWER_BUDGET_H
+
+#include "PowerSwitch.h"
+#include "../constraint/ConstraintEventHandler.h"
+
+#include <vector>
+
+namespace automation {
+
+  // Ledger of watts committed to switches that are on.  Updated from toggle events so reads do not have to poll
+  // every switch (OpenHAB switches can make an HTTP request in isOn).  Switches changed outside of this process
+  // are picked up by sync().
+  //
+  // A switch about to start (waiting on a pass delay) can reserve its watts so other devices deciding at the same
+  // time see the power as taken.  Reservations are released when the switch turns on (watts become committed),
+  // by release() or when they expire.
+  class PowerBudget : public Capability::CapabilityListener {
+  public:
+
+    struct Entry {
+      const PowerSwitch* pSwitch;
+      bool bOn;
+      bool bReserved;
+      unsigned long reservationExpireMs;
+    };
+
+    void add(PowerSwitch* pSwitch) {
+      entries.push_back({pSwitch, pSwitch->isOn(), false, 0});
+      if ( entries.back().bOn ) {
+        committedWatts += pSwitch->requiredWatts;
+      }
+      pSwitch->toggle.addListener(this);
+    }
+
+    float getCommittedWatts() const { return committedWatts; }
+
+    float getReservedWatts() const { return reservedWatts; }
+
+    // Watts needed if pCandidate is (or stays) on: committed watts plus reservations of other switches
+    float getRequiredWatts(const Device* pCandidate = nullptr) const {
+      float watts = committedWatts + reservedWatts;
+      const Entry* pEntry = find(pCandidate);
+      if ( pEntry ) {
+        if ( pEntry->bReserved ) {
+          watts -= pEntry->pSwitch->requiredWatts;
+        }
+        if ( !pEntry->bOn ) {
+          watts += pEntry->pSwitch->requiredWatts;
+        }
+      }
+      return watts;
+    }
+
+    bool isOn(const Device* pDevice) const {
+      const Entry* pEntry = find(pDevice);
+      return pEntry && pEntry->bOn;
+    }
+
+    // returns false if pSwitch is unknown or already on
+    bool reserve(const PowerSwitch* pSwitch, unsigned long ttlMs) {
+      Entry* pEntry = find(pSwitch);
+      if ( !pEntry || pEntry->bOn ) {
+        return false;
+      }
+      if ( !pEntry->bReserved ) {
+        pEntry->bReserved = true;
+        reservedWatts += pSwitch->requiredWatts;
+      }
+      pEntry->reservationExpireMs = millisecs() + ttlMs;
+      return true;
+    }
+
+    void release(const PowerSwitch* pSwitch) {
+      Entry* pEntry = find(pSwitch);
+      if ( pEntry ) {
+        release(*pEntry);
+      }
+    }
+
+    // Reconcile with the switches (call after refreshing remote switch state) and drop expired reservations
+    void sync() {
+      unsigned long nowMs = millisecs();
+      committedWatts = reservedWatts = 0;
+      for ( Entry& entry : entries ) {
+        entry.bOn = entry.pSwitch->isOnObserved();
+        if ( entry.bOn || (entry.bReserved && (long)(nowMs - entry.reservationExpireMs) >= 0) ) {
+          entry.bReserved = false;
+        }
+        if ( entry.bOn ) {
+          committedWatts += entry.pSwitch->requiredWatts;
+        } else if ( entry.bReserved ) {
+          reservedWatts += entry.pSwitch->requiredWatts;
+        }
+      }
+    }
+
+    void valueSet(const Capability* pCapability, float newVal, float oldVal) override {
+      for ( Entry& entry : entries ) {
+        if ( &entry.pSwitch->toggle == pCapability ) {
+          bool bOn = newVal != 0;
+          if ( bOn != entry.bOn ) {
+            entry.bOn = bOn;
+            committedWatts += bOn ? entry.pSwitch->requiredWatts : -entry.pSwitch->requiredWatts;
+          }
+          if ( bOn ) {
+            release(entry);
+          }
+          break;
+        }
+      }
+    }
+
+  protected:
+    std::vector<Entry> entries;
+    float committedWatts = 0;
+    float reservedWatts = 0;
+
+    void release(Entry& entry) {
+      if ( entry.bReserved ) {
+        entry.bReserved = false;
+        reservedWatts -= entry.pSwitch->requiredWatts;
+      }
+    }
+
+    const Entry* find(const Device* pDevice) const {
+      for ( const Entry& entry : entries ) {
+        if ( entry.pSwitch == pDevice ) {
+          return &entry;
+        }
+      }
+      return nullptr;
+    }
+
+    Entry* find(const Device* pDevice) {
+      return const_cast<Entry*>(static_cast<const PowerBudget*>(this)->find(pDevice));
+    }
+  };
+
+  // Added to the listeners of a switch's "enough power" constraint.  Reserves the switch's watts while the
+  // constraint waits out its pass delay (plus extraMs to cover the other constraints) and releases them if the
+  // deferral is cancelled or the constraint fails.
+  class PowerReservationHandler : public ConstraintEventHandler {
+  public:
+    PowerReservationHandler(PowerBudget& budget, const PowerSwitch* pSwitch, unsigned long extraMs = 60000) :
+      budget(budget), pSwitch(pSwitch), extraMs(extraMs) {
+    }
+
+    void resultDeferred(Constraint* pConstraint,bool bNew,unsigned long delayMs) const override {
+      if ( bNew ) {
+        budget.reserve(pSwitch, delayMs + extraMs);
+      }
+    }
+
+    void resultChanged(Constraint* pConstraint,bool bNew,unsigned long lastDurationMs) const override {
+      if ( !bNew ) {
+        budget.release(pSwitch);
+      }
+    }
+
+    void deferralCancelled(Constraint* pConstraint,bool bNew,unsigned long lastDurationMs) const override {
+      if ( !bNew ) {
+        budget.release(pSwitch);
+      }
+    }
+
+  protected:
+    PowerBudget& budget;
+    const PowerSwitch* pSwitch;
+    unsigned long extraMs;
+  };
+
+}
+#endif
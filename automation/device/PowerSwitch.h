@@ -24,14 +24,23 @@ public:
     float getValueImpl() const override
     {
       //cout << __PRETTY_FUNCTION__ << endl;
-      return (float)pPowerSwitch->isOn();
+      return (float)pPowerSwitch->isOnObserved();
     }
     bool setValueImpl(float val) override
     {
       //cout << __PRETTY_FUNCTION__ << "=" << val << endl;
+      #ifndef ARDUINO_APP
+      pPowerSwitch->requestOn(val != 0);
+      #else
       pPowerSwitch->setOn(val != 0);
+      #endif
       return true;
     }
+    #ifndef ARDUINO_APP
+    // listeners (start coordinator, power budget, metrics) hear about a state once flush() sent it
+    void notifyValueSetListeners(float newVal, float oldVal) override {}
+    void notifySent(bool bOn, bool bWasOn) { Capability::notifyValueSetListeners(bOn, bWasOn); }
+    #endif
   } toggle;
 
   ToggleSensor toggleSensor; // allow the switch state to be seen as a sensor
@@ -44,6 +53,75 @@ public:
   virtual bool isOn() const = 0;
   virtual void setOn(bool bOn) = 0;
 
+  #ifndef ARDUINO_APP
+  // Observed state for constraints, toggles, budgets and REST output.  Reading it never calls the device: only
+  // refreshObservedState() (the app's refresh phase, once per tick) and successful commands update it.  So it is at
+  // most one tick old, plus whatever the switch itself caches (openhab item states up to their TTL when not pushed).
+  bool isOnObserved() const {
+    if ( !bObserved ) {
+      refreshObservedState(); // read before the first refresh phase
+      bObserved = true;
+    }
+    return bObservedOn;
+  }
+
+  // read the device (isOn()).  Keeps the last observed state if that fails (bError).
+  bool refreshObservedState() const {
+    bool bOn = isOn();
+    if ( !bError ) {
+      observe(bOn);
+    }
+    return bObservedOn;
+  }
+
+  unsigned long getObservedAgeMs() const { return millisecs() - observedMs; }
+
+  // Desired state register.  Commands (constraint results, remote "on") only record the wanted state and flush()
+  // sends the latest one if it differs from the last acknowledged state.  OFF is sent right away.  Switches that
+  // never acknowledge() (no read back) are always sent the command since the device may have been switched outside
+  // the app.
+  void requestOn(bool bOn) {
+    desiredState = bOn ? 1 : 0;
+    if ( !bOn ) {
+      flush();
+    }
+  }
+
+  // returns true if setOn() was called.  A failed setOn() (bError) leaves the command pending.
+  bool flush() {
+    if ( desiredState == UNKNOWN_STATE ) {
+      return false;
+    }
+    bool bOn = desiredState == 1;
+    desiredState = UNKNOWN_STATE;
+    if ( bReadBack && ackedState == desiredStateOf(bOn) ) {
+      return false;
+    }
+    ackedState = desiredStateOf(bOn);
+    bool bWasOn = isOnObserved();
+    setOn(bOn);
+    if ( !bError ) {
+      observe(bOn);
+      toggle.notifySent(bOn, bWasOn);
+    }
+    if ( desiredState == desiredStateOf(bOn) ) {
+      desiredState = UNKNOWN_STATE; // setOn() echoed the command back through the constraint
+    }
+    if ( bError ) {
+      ackedState = UNKNOWN_STATE;
+      if ( desiredState == UNKNOWN_STATE ) {
+        desiredState = desiredStateOf(bOn);
+      }
+    }
+    return true;
+  }
+
+  bool isCommandPending() const { return desiredState != UNKNOWN_STATE; }
+  bool isOffPending() const { return desiredState == 0; }
+  #else
+  bool isOnObserved() const { return isOn(); }
+  #endif
+
   //virtual void constraintResultChanged(bool bConstraintResult)
   virtual void resultChanged(Constraint* pConstraint,bool bNew,unsigned long lastDurationMs) const override {
     //cout << __PRETTY_FUNCTION__ << "'" << name << "' passed: " << bNew << endl;
@@ -77,8 +155,48 @@ public:
 
   void printVerboseExtra(json::JsonStreamWriter& w) const {
       automation::Device::printVerboseExtra(w);
-      w.printlnBoolObj(F("on"),isOn(),",");
+      w.printlnBoolObj(F("on"),isOnObserved(),",");
+      #ifndef ARDUINO_APP
+      w.printlnNumberObj(F("observedAgeMs"),getObservedAgeMs(),",");
+      if ( isCommandPending() ) {
+        w.printlnBoolObj(F("pendingOn"),desiredState == 1,",");
+      }
+      #endif
+    }
+
+  #ifndef ARDUINO_APP
+protected:
+  static const int8_t UNKNOWN_STATE = -1;
+  mutable int8_t desiredState = UNKNOWN_STATE;
+  mutable int8_t ackedState = UNKNOWN_STATE;
+  mutable bool bReadBack = false; // acknowledge() was called so ackedState is the device's state
+  mutable bool bObserved = false, bObservedOn = false;
+  mutable unsigned long observedMs = 0;
+
+  static int8_t desiredStateOf(bool bOn) { return bOn ? 1 : 0; }
+
+  void observe(bool bOn) const {
+    bObserved = true;
+    bObservedOn = bOn;
+    observedMs = millisecs();
+  }
+
+  // a command setOn() accepted failed later (sent in the background) so it is pending again
+  void commandFailed(bool bOn) const {
+    bError = true;
+    ackedState = UNKNOWN_STATE;
+    if ( desiredState == UNKNOWN_STATE ) {
+      desiredState = desiredStateOf(bOn);
     }
+  }
+
+  // actual state observed by the subclass (changed remotely or read back from the device)
+  void acknowledge(bool bOn) const {
+    bReadBack = true;
+    ackedState = desiredStateOf(bOn);
+    observe(bOn);
+  }
+  #endif
 
 };
 } // namespace automation
@@ -0,0 +1,179 @@
+#ifndef AUTOMATION_FILTERSENSOR_H
+#define AUTOMATION_FILTERSENSOR_H
+
+#include "../Automation.h"
+#include "Sensor.h"
+
+#include <string>
+#include <vector>
+#include <math.h>
+
+using namespace std;
+
+namespace automation {
+
+  // One step of input cleanup.  Stages keep any window they need in fixed size members so filtering a sample
+  // does not allocate (works on arduino).
+  class FilterStage {
+  public:
+    virtual float apply(float val) = 0;
+    virtual void reset() {}
+    virtual ~FilterStage() {}
+  };
+
+  // Last WindowSize readings (NAN readings are skipped).  After WindowSize NAN readings in a row the window is
+  // cleared so a failed sensor is not hidden forever.
+  template<uint8_t WindowSize>
+  class WindowStage : public FilterStage {
+  public:
+    void reset() override {
+      cnt = next = nanCnt = 0;
+    }
+
+  protected:
+    float window[WindowSize];
+    uint8_t cnt = 0, next = 0, nanCnt = 0;
+
+    // false if val is NAN
+    bool add(float val) {
+      if ( isnan(val) ) {
+        if ( ++nanCnt >= WindowSize ) {
+          reset();
+        }
+        return false;
+      }
+      nanCnt = 0;
+      window[next] = val;
+      next = (next + 1) % WindowSize;
+      if ( cnt < WindowSize ) {
+        cnt++;
+      }
+      return true;
+    }
+
+    // median of the first cnt values of vals (reorders vals)
+    static float median(float* vals, uint8_t cnt) {
+      for ( uint8_t i = 1; i < cnt; i++ ) {
+        float val = vals[i];
+        uint8_t j = i;
+        for ( ; j > 0 && vals[j-1] > val; j-- ) {
+          vals[j] = vals[j-1];
+        }
+        vals[j] = val;
+      }
+      return cnt % 2 ? vals[cnt/2] : (vals[cnt/2-1] + vals[cnt/2]) / 2;
+    }
+
+    float windowMedian() const {
+      float vals[WindowSize];
+      for ( uint8_t i = 0; i < cnt; i++ ) {
+        vals[i] = window[i];
+      }
+      return median(vals, cnt);
+    }
+  };
+
+  // Median of the last WindowSize readings
+  template<uint8_t WindowSize>
+  class MedianStage : public WindowStage<WindowSize> {
+  public:
+    float apply(float val) override {
+      this->add(val);
+      return this->cnt ? this->windowMedian() : NAN;
+    }
+  };
+
+  // Replace a reading further than threshold scaled median absolute deviations from the median of the window
+  // with that median (Hampel filter).  Readings are passed through until the window has 3 values.
+  template<uint8_t WindowSize>
+  class HampelStage : public WindowStage<WindowSize> {
+  public:
+    float threshold;
+    float minDeviation; // keeps a flat window (MAD of 0) from rejecting every small change
+
+    HampelStage(float threshold = 3, float minDeviation = 0) : threshold(threshold), minDeviation(minDeviation) {
+    }
+
+    float apply(float val) override {
+      if ( isnan(val) || this->cnt < 3 ) {
+        this->add(val);
+        return val;
+      }
+      float vals[WindowSize];
+      for ( uint8_t i = 0; i < this->cnt; i++ ) {
+        vals[i] = this->window[i];
+      }
+      float med = this->median(vals, this->cnt);
+      for ( uint8_t i = 0; i < this->cnt; i++ ) {
+        vals[i] = fabs(this->window[i] - med);
+      }
+      float deviation = 1.4826 * this->median(vals, this->cnt); // MAD scaled to standard deviation
+      if ( deviation < minDeviation ) {
+        deviation = minDeviation;
+      }
+      this->add(val); // outliers stay in the window so a real step change is accepted once it persists
+      return fabs(val - med) > threshold * deviation ? med : val;
+    }
+  };
+
+  // Limit readings to [minVal,maxVal].  With bReject readings outside the range become NAN instead (zero from a
+  // thermistor read while other pins are busy for example).
+  class ClampStage : public FilterStage {
+  public:
+    float minVal, maxVal;
+    bool bReject;
+
+    ClampStage(float minVal, float maxVal, bool bReject = false) : minVal(minVal), maxVal(maxVal), bReject(bReject) {
+    }
+
+    float apply(float val) override {
+      if ( val < minVal ) {
+        return bReject ? NAN : minVal;
+      } else if ( val > maxVal ) {
+        return bReject ? NAN : maxVal;
+      }
+      return val;
+    }
+  };
+
+  // scale * reading + offset
+  class CalibrationStage : public FilterStage {
+  public:
+    float scale, offset;
+
+    CalibrationStage(float scale, float offset = 0) : scale(scale), offset(offset) {
+    }
+
+    float apply(float val) override {
+      return scale * val + offset;
+    }
+  };
+
+  // Source sensor reading passed through stages in order.  Each refresh of this sensor filters one reading so
+  // the source should be refreshed first (earlier in the sensors list).
+  class FilterSensor : public Sensor {
+  public:
+    RTTI_GET_TYPE_IMPL(automation,FilterSensor)
+
+    Sensor& sourceSensor;
+    vector<FilterStage*> stages;
+
+    FilterSensor(const std::string& name, Sensor& sourceSensor, const vector<FilterStage*>& stages) :
+      Sensor(name),
+      sourceSensor(sourceSensor),
+      stages(stages) {
+      setCanSample(false); // stages expect one reading per refresh
+    }
+
+    float getValueImpl() const override {
+      float val = sourceSensor.getValue();
+      for ( FilterStage* pStage : stages ) {
+        val = pStage->apply(val);
+      }
+      return val;
+    }
+  };
+
+}
+
+#endif
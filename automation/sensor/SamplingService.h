@@ -0,0 +1,117 @@
+#ifndef AUTOMATION_SAMPLING_SERVICE_H
+#define AUTOMATION_SAMPLING_SERVICE_H
+
+#ifndef ARDUINO_APP
+
+#include "Sensor.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <climits>
+
+namespace automation {
+
+  // Takes the samples of multi-sample sensors (sampleCnt > 1) on its own thread instead of Sensor::sample()
+  // sleeping between samples on the caller's thread.  Samples of all sensors are interleaved by when each is due
+  // and the average is published when a sensor's last sample completes.  Reads and publishing happen while holding
+  // appMutex (the lock the main loop and http handlers hold while using sensors).  Registered sensors are marked
+  // AsyncSampled so getValue() returns the last published average (NAN until the first one).
+  template<typename MutexT>
+  class SamplingService {
+  public:
+
+    SamplingService(MutexT& appMutex) : appMutex(appMutex) {
+    }
+
+    ~SamplingService() {
+      stop();
+    }
+
+    // call before start()
+    void add(Sensor* pSensor) {
+      pSensor->setAsyncSampled(true);
+      pSensor->publishSample(NAN);
+      jobs.push_back({pSensor, 0, 0, 0});
+    }
+
+    bool empty() const {
+      return jobs.empty();
+    }
+
+    void start() {
+      bStop = false;
+      worker = std::thread(&SamplingService::run, this);
+    }
+
+    void stop() {
+      {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        bStop = true;
+      }
+      stopCondition.notify_all();
+      if ( worker.joinable() ) {
+        worker.join();
+      }
+    }
+
+  protected:
+
+    struct Job {
+      Sensor* pSensor;
+      float sum;
+      unsigned int cnt;
+      unsigned long nextSampleMs;
+    };
+
+    MutexT& appMutex;
+    std::vector<Job> jobs;
+    std::thread worker;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool bStop = false;
+
+    void run() {
+      std::unique_lock<std::mutex> lock(stopMutex);
+      while ( !bStop ) {
+        lock.unlock();
+        unsigned long nowMs = millisecs();
+        long waitMs = jobs.empty() ? 1000 : LONG_MAX;
+        for ( Job& job : jobs ) {
+          long dueMs = (long)(job.nextSampleMs - nowMs);
+          if ( dueMs <= 0 ) {
+            sample(job);
+            job.nextSampleMs = nowMs + job.pSensor->sampleIntervalMs;
+            dueMs = job.pSensor->sampleIntervalMs;
+          }
+          waitMs = std::min(waitMs, dueMs);
+        }
+        lock.lock();
+        stopCondition.wait_for(lock, std::chrono::milliseconds(waitMs), [this]{ return bStop; });
+      }
+    }
+
+    void sample(Job& job) {
+      std::lock_guard<MutexT> appLock(appMutex);
+      float val = job.pSensor->getValueImpl();
+      if ( isnan(val) ) {
+        job.pSensor->publishSample(val); // same as Sensor::sample(), a failed read fails the average
+        job.sum = 0;
+        job.cnt = 0;
+        return;
+      }
+      job.sum += val;
+      if ( ++job.cnt >= job.pSensor->sampleCnt ) {
+        job.pSensor->publishSample(job.sum / job.cnt);
+        job.sum = 0;
+        job.cnt = 0;
+      }
+    }
+  };
+
+}
+
+#endif
+#endif
@@ -73,5 +73,9 @@ namespace automation {
     w.print("}");
   }
 
+  #ifndef ARDUINO_APP
+  SensorSnapshot SensorSnapshot::instance;
+  #endif
+
 }
 
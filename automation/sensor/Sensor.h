@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <math.h>
 #ifndef ARDUINO_APP
+#include "SensorHistory.h"
+#include "SensorSnapshot.h"
 #include <memory>
 #endif
 
@@ -32,17 +34,45 @@ namespace automation {
     virtual void changed(const Sensor* pSensor, float newVal, float oldVal) const = 0;
   };
 
+  #ifndef ARDUINO_APP
+  // A listener is told about a change once the value moved by at least deadband from the value it was last told
+  // about and at least minIntervalMs passed since then.  oldVal passed to the listener is that last value.
+  struct SensorSubscription {
+    SensorListener* pListener;
+    float deadband;
+    unsigned long minIntervalMs;
+    float lastValue;
+    unsigned long lastNotifyMs;
+    bool bNotified;
+
+    bool isChange(float val, unsigned long nowMs) const {
+      if ( !bNotified ) {
+        return true;
+      }
+      if ( isnan(val) || isnan(lastValue) ) {
+        if ( isnan(val) == isnan(lastValue) ) {
+          return false;
+        }
+      } else if ( val == lastValue || fabs(val - lastValue) < deadband ) {
+        return false;
+      }
+      return nowMs - lastNotifyMs >= minIntervalMs;
+    }
+  };
+  #endif
+
   class Sensor : public ValueHolder<float>, public NamedContainer {
   public:    
     RTTI_GET_TYPE_DECL;
 
-    enum State { Undefined = 0, Initialized = 0x01, NotExpired = 0x02, NotSampleable = 0x04, NotCacheable = 0x08, Error = 0x0F };
+    enum State { Undefined = 0, Initialized = 0x01, NotExpired = 0x02, NotSampleable = 0x04, NotCacheable = 0x08, Error = 0x10, AsyncSampled = 0x20 };
 
     uint16_t sampleCnt;
     uint16_t sampleIntervalMs;
     
     #ifndef ARDUINO_APP
-    std::unique_ptr<automation::SensorListener> pListener; // no space left for arduino to have listeners :-(
+    mutable std::vector<SensorSubscription> listeners; // no space left for arduino to have listeners :-(
+    std::unique_ptr<SensorHistory> pHistory; // recent values, see enableHistory()
     #endif
 
     Sensor(const std::string& name, uint16_t sampleCnt=1, uint16_t sampleIntervalMs=35) : 
@@ -100,32 +130,84 @@ namespace automation {
       }
     }
 
+    // value is published by a background sampler (SamplingService) so getValue() only returns the last result
+    void setAsyncSampled(bool bAsyncSampled) {
+      if ( bAsyncSampled ) {
+        state |= State::AsyncSampled;
+      } else {
+        state = state & ~State::AsyncSampled;
+      }
+    }
+
     bool isInitialized() const { return (state & State::Initialized) > 0; }
     bool isError() const { return (state & State::Error) > 0; }
     bool isCacheExpired() const { return (state & State::NotExpired) == 0; }
     bool isCacheValid() const { return canCache() && !isCacheExpired(); }
     bool canCache() const { return ( state & State::NotCacheable ) == 0 ; }
     bool canSample() const { return ( state & State::NotSampleable) == 0; }
+    bool isAsyncSampled() const { return ( state & State::AsyncSampled) != 0; }
 
     float getValue() const override {
 
+      #ifndef ARDUINO_APP
+      float snapshotValue;
+      if ( SensorSnapshot::instance.find(id, snapshotValue) ) {
+        return snapshotValue;
+      }
+      #endif
+
+      if ( isAsyncSampled() ) {
+        return cachedValue;
+      }
+
       if ( !isCacheValid() ) {     
 
         float val = sample(this, &Sensor::getValueImpl, sampleCnt, sampleIntervalMs);
 
         if ( canCache() ) {
-          float old = cachedValue;
-          setCachedValue(val);        
-
-          #ifndef ARDUINO_APP
-          if ( old != val && pListener ) {
-            pListener->changed(this,val,old);
-          }
-          #endif
+          publishSample(val);
+        } else {
+          return val;
         }
       }
       return cachedValue;
     }
+
+    // cache a completed (averaged) sample and notify listener if it changed
+    void publishSample(float val) const {
+      setCachedValue(val);
+
+      #ifndef ARDUINO_APP
+      if ( pHistory ) {
+        pHistory->add(val, millisecs());
+      }
+      if ( !listeners.empty() ) {
+        notifyListeners(val);
+      }
+      #endif
+    }
+
+    #ifndef ARDUINO_APP
+    void addListener(SensorListener* pListener, float deadband = 0, unsigned long minIntervalMs = 0) {
+      listeners.push_back({pListener, deadband, minIntervalMs, NAN, 0, false});
+    }
+
+    void removeListener(SensorListener* pListener) {
+      listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+          [pListener](const SensorSubscription& sub) { return sub.pListener == pListener; }), listeners.end());
+    }
+    #endif
+
+    #ifndef ARDUINO_APP
+    // Keep the last capacity cached values (newer than maxAgeMs if not 0).  Returns the existing history if
+    // already enabled.
+    SensorHistory& enableHistory(uint16_t capacity, unsigned long maxAgeMs = 0) {
+      if ( !pHistory ) {
+        pHistory.reset(new SensorHistory(capacity, maxAgeMs));
+      }
+      return *pHistory;
+    }
+    #endif
     
     virtual float getValueImpl() const = 0;
 
@@ -200,6 +282,21 @@ namespace automation {
       cachedValue = v;
       setCacheExpired(false);
     }
+
+    #ifndef ARDUINO_APP
+    void notifyListeners(float val) const {
+      unsigned long nowMs = millisecs();
+      for ( SensorSubscription& sub : listeners ) {
+        if ( sub.isChange(val, nowMs) ) {
+          float old = sub.lastValue;
+          sub.lastValue = val;
+          sub.lastNotifyMs = nowMs;
+          sub.bNotified = true;
+          sub.pListener->changed(this, val, old);
+        }
+      }
+    }
+    #endif
   };
 
   class SensorFn : public Sensor {
@@ -270,6 +367,15 @@ namespace automation {
     bool isComplete() const {
       return pSensor->isCacheValid();
     }
+
+    // time until sensor's sample interval elapsed
+    unsigned long remainingMs() const {
+      if ( !lastSampleTimer.haveStartTime() ) {
+        return 0;
+      }
+      TimerVal elapsedMs = lastSampleTimer.getElapsedDurationMs();
+      return elapsedMs > pSensor->sampleIntervalMs ? 0 : pSensor->sampleIntervalMs - elapsedMs + 1;
+    }
   };
 
   class Sensors : public AttributeContainerVector<Sensor*> {
@@ -284,6 +390,19 @@ namespace automation {
       }
     }
 
+    #ifndef ARDUINO_APP
+    // read every cacheable sensor into the snapshot (non-cacheable sensors depend on when they are read)
+    void takeSnapshot(SensorSnapshot& snapshot = SensorSnapshot::instance) const {
+      snapshot.begin();
+      for( const Sensor* pSensor : *this ) {
+        if ( pSensor->canCache() ) {
+          snapshot.set(pSensor->id, pSensor->getValue());
+        }
+      }
+      snapshot.commit();
+    }
+    #endif
+
     void getValuesBySampling() 
     {
       std::vector<SensorSampler> sampleVec;
@@ -295,10 +414,19 @@ namespace automation {
       }
 
       while( !sampleVec.empty() ) {
+        bool bSampled = false;
         for( SensorSampler& sampler : sampleVec) {
-          sampler.doSingleSample();
+          bSampled |= sampler.doSingleSample();
         }
         sampleVec.erase( std::remove_if(sampleVec.begin(),sampleVec.end(), [](const SensorSampler& ss){return ss.isComplete();}), sampleVec.end());
+        if ( !bSampled && !sampleVec.empty() ) {
+          // nothing due yet so wait for the next sample instead of spinning
+          unsigned long waitMs = sampleVec[0].remainingMs();
+          for( const SensorSampler& sampler : sampleVec) {
+            waitMs = std::min(waitMs, sampler.remainingMs());
+          }
+          automation::sleep(waitMs);
+        }
       };
     }
 
@@ -0,0 +1,155 @@
+#ifndef AUTOMATION_SENSOR_HISTORY_H
+#define AUTOMATION_SENSOR_HISTORY_H
+
+#ifndef ARDUINO_APP
+
+#include <memory>
+#include <stdint.h>
+#include <math.h>
+
+namespace automation {
+
+  // Last capacity values of a sensor (optionally only those newer than maxAgeMs) with statistics of that window
+  // updated as values are added and dropped.  Mean uses running sums, min/max use monotonic deques of sample
+  // sequence numbers and slope is a least squares fit from running sums, so every statistic is O(1) to read and
+  // amortized O(1) to update.  All storage is allocated by the constructor.
+  class SensorHistory {
+  public:
+
+    const uint16_t capacity;
+    const unsigned long maxAgeMs; // 0 keeps samples until pushed out by newer ones
+    const float emaAlpha;
+
+    SensorHistory(uint16_t capacity, unsigned long maxAgeMs = 0, float emaAlpha = 0.2) :
+      capacity(capacity ? capacity : 1),
+      maxAgeMs(maxAgeMs),
+      emaAlpha(emaAlpha),
+      samples(new Sample[this->capacity]),
+      minSeqs(new uint32_t[this->capacity]),
+      maxSeqs(new uint32_t[this->capacity]) {
+      clear();
+    }
+
+    void add(float val, unsigned long timeMs) {
+      if ( isnan(val) ) {
+        return;
+      }
+      expire(timeMs);
+      if ( size() == capacity ) {
+        removeOldest();
+      }
+      if ( empty() || timeMs - baseMs > REBASE_MS ) {
+        rebase(empty() ? timeMs : sample(headSeq).timeMs);
+      }
+      uint32_t seq = tailSeq++;
+      sample(seq) = {val, timeMs};
+      double t = seconds(timeMs);
+      sum += val;
+      sumT += t;
+      sumTT += t*t;
+      sumTV += t*val;
+
+      while ( minBack != minFront && sample(minSeqs[(minBack-1) % capacity]).val >= val ) {
+        minBack--;
+      }
+      minSeqs[minBack++ % capacity] = seq;
+      while ( maxBack != maxFront && sample(maxSeqs[(maxBack-1) % capacity]).val <= val ) {
+        maxBack--;
+      }
+      maxSeqs[maxBack++ % capacity] = seq;
+
+      emaVal = isnan(emaVal) ? val : emaAlpha*val + (1-emaAlpha)*emaVal;
+    }
+
+    // drop samples older than maxAgeMs
+    void expire(unsigned long nowMs) {
+      while ( maxAgeMs && !empty() && nowMs - sample(headSeq).timeMs > maxAgeMs ) {
+        removeOldest();
+      }
+    }
+
+    void clear() {
+      headSeq = tailSeq = 0;
+      minFront = minBack = maxFront = maxBack = 0;
+      sum = sumT = sumTT = sumTV = 0;
+      baseMs = 0;
+      emaVal = NAN;
+    }
+
+    uint16_t size() const { return tailSeq - headSeq; }
+    bool empty() const { return tailSeq == headSeq; }
+
+    float latest() const { return empty() ? NAN : sample(tailSeq-1).val; }
+    float mean() const { return empty() ? NAN : sum / size(); }
+    float minimum() const { return empty() ? NAN : sample(minSeqs[minFront % capacity]).val; }
+    float maximum() const { return empty() ? NAN : sample(maxSeqs[maxFront % capacity]).val; }
+
+    // exponential moving average of every value added (not limited to the window)
+    float ema() const { return emaVal; }
+
+    // change per second of the least squares line through the window
+    float slope() const {
+      double n = size();
+      double denominator = n*sumTT - sumT*sumT;
+      if ( n < 2 || denominator <= 0 ) {
+        return NAN;
+      }
+      return (n*sumTV - sumT*sum) / denominator;
+    }
+
+  protected:
+    // times are seconds since baseMs in the sums.  Rebasing keeps them small (precise) and rebuilds the sums
+    // which also clears accumulated rounding error.
+    static const unsigned long REBASE_MS = 24*60*60*1000UL;
+
+    struct Sample {
+      float val;
+      unsigned long timeMs;
+    };
+
+    std::unique_ptr<Sample[]> samples;
+    std::unique_ptr<uint32_t[]> minSeqs, maxSeqs; // deques of sample sequence numbers with increasing/decreasing values
+    uint32_t headSeq, tailSeq;
+    uint32_t minFront, minBack, maxFront, maxBack;
+    double sum, sumT, sumTT, sumTV;
+    unsigned long baseMs;
+    float emaVal;
+
+    Sample& sample(uint32_t seq) const { return samples[seq % capacity]; }
+
+    double seconds(unsigned long timeMs) const { return (timeMs - baseMs) / 1000.0; }
+
+    void removeOldest() {
+      const Sample& oldest = sample(headSeq);
+      double t = seconds(oldest.timeMs);
+      sum -= oldest.val;
+      sumT -= t;
+      sumTT -= t*t;
+      sumTV -= t*oldest.val;
+      if ( minFront != minBack && minSeqs[minFront % capacity] == headSeq ) {
+        minFront++;
+      }
+      if ( maxFront != maxBack && maxSeqs[maxFront % capacity] == headSeq ) {
+        maxFront++;
+      }
+      headSeq++;
+    }
+
+    void rebase(unsigned long newBaseMs) {
+      baseMs = newBaseMs;
+      sum = sumT = sumTT = sumTV = 0;
+      for ( uint32_t seq = headSeq; seq != tailSeq; seq++ ) {
+        const Sample& s = sample(seq);
+        double t = seconds(s.timeMs);
+        sum += s.val;
+        sumT += t;
+        sumTT += t*t;
+        sumTV += t*s.val;
+      }
+    }
+  };
+
+}
+
+#endif
+#endif
@@ -0,0 +1,65 @@
+#ifndef AUTOMATION_SENSOR_SNAPSHOT_H
+#define AUTOMATION_SENSOR_SNAPSHOT_H
+
+#ifndef ARDUINO_APP
+
+#include "../AttributeContainer.h"
+
+#include <stdint.h>
+
+namespace automation {
+
+  // Sensor values read once at the start of a tick so every device (and REST output until the next tick) sees the
+  // same value of a sensor.  Values are stored in a flat array indexed by sensor id (ids are assigned densely by
+  // NumericIdentifier).  Sensor::getValue() returns the snapshot value while the snapshot is active and the
+  // sensor is part of it.  Released while sensors are being refreshed so reads go to the sensor.
+  class SensorSnapshot {
+  public:
+
+    void begin() {
+      bActive = false;
+      if ( ++generation == 0 ) { // wrapped so old stamps could match
+        for ( auto& stamp : stamps ) {
+          stamp = 0;
+        }
+        generation = 1;
+      }
+    }
+
+    void set(NumericIdentifierValue id, float value) {
+      values[id] = value;
+      stamps[id] = generation;
+    }
+
+    // activate after all values set
+    void commit() {
+      bActive = true;
+    }
+
+    void release() {
+      bActive = false;
+    }
+
+    bool isActive() const { return bActive; }
+
+    bool find(NumericIdentifierValue id, float& value) const {
+      if ( bActive && stamps[id] == generation ) {
+        value = values[id];
+        return true;
+      }
+      return false;
+    }
+
+    static SensorSnapshot instance;
+
+  protected:
+    bool bActive = false;
+    uint32_t generation = 0;
+    float values[NumericIdentifierMax+1];
+    uint32_t stamps[NumericIdentifierMax+1] = {};
+  };
+
+}
+
+#endif
+#endif
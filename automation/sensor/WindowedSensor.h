@@ -0,0 +1,66 @@
+#ifndef AUTOMATION_WINDOWED_SENSOR_H
+#define AUTOMATION_WINDOWED_SENSOR_H
+
+#ifndef ARDUINO_APP
+
+#include "Sensor.h"
+
+namespace automation {
+
+  // Statistic of the recent values of another sensor.  Enables history on the source sensor (the first
+  // capacity/windowMs requested for a sensor is used by all windowed sensors of that source).
+  class WindowedSensor : public Sensor {
+  public:
+    Sensor& sourceSensor;
+    SensorHistory& history;
+
+    WindowedSensor(const std::string& statName, Sensor& sourceSensor, uint16_t capacity, unsigned long windowMs) :
+      Sensor(statName + "(" + sourceSensor.name + ")"),
+      sourceSensor(sourceSensor),
+      history(sourceSensor.enableHistory(capacity, windowMs)) {
+    }
+
+    float getValueImpl() const override {
+      sourceSensor.getValue(); // refresh source if its cache expired
+      history.expire(millisecs());
+      return getStatistic();
+    }
+
+    virtual float getStatistic() const = 0;
+  };
+
+  // Mean of the source's values within the window
+  class WindowedAverageSensor : public WindowedSensor {
+  public:
+    RTTI_GET_TYPE_IMPL(automation,WindowedAverage)
+
+    WindowedAverageSensor(Sensor& sourceSensor, uint16_t capacity, unsigned long windowMs = 0) :
+      WindowedSensor("Average", sourceSensor, capacity, windowMs) {
+    }
+
+    float getStatistic() const override {
+      return history.mean();
+    }
+  };
+
+  // Trend of the source's values within the window as change per perSeconds (per minute by default)
+  class SlopeSensor : public WindowedSensor {
+  public:
+    RTTI_GET_TYPE_IMPL(automation,Slope)
+
+    float perSeconds;
+
+    SlopeSensor(Sensor& sourceSensor, uint16_t capacity, unsigned long windowMs = 0, float perSeconds = 60) :
+      WindowedSensor("Slope", sourceSensor, capacity, windowMs),
+      perSeconds(perSeconds) {
+    }
+
+    float getStatistic() const override {
+      return history.slope() * perSeconds;
+    }
+  };
+
+}
+
+#endif
+#endif
@@ -2,22 +2,40 @@
 #define SOLAR_IFTTT_POWERSWITCH_H
 
 #include "../automation/device/PowerSwitch.h"
-#include "WebHookSession.h"
+#include "WebHookDispatcher.h"
 #include "WebHookEvent.h"
 
+#include <atomic>
+
 namespace ifttt {
 
   class PowerSwitch : public automation::PowerSwitch {
   public:
     RTTI_GET_TYPE_IMPL(ifttt,PowerSwitch);
 
-    const int MAX_RETRY_CNT = 2;
-
-    bool bLastValueSent;
+    std::atomic<bool> bLastValueSent; // set by the dispatcher once an event was sent
 
     string strIftttKey, strOnEventLabel, strOffEventLabel;
 
-    PowerSwitch(const string &id, const string& iftttKey, float requiredWatts) : automation::PowerSwitch(id,requiredWatts), strIftttKey(iftttKey), bLastValueSent(false) {}
+    WebHookDispatcher dispatcher;
+
+    PowerSwitch(const string &id, const string& iftttKey, float requiredWatts) :
+      automation::PowerSwitch(id,requiredWatts), bLastValueSent(false), strIftttKey(iftttKey), dispatcher(WebHookSession(iftttKey)) {
+      dispatcher.sendDone = [this](const WebHookEvent& evt, bool bSent) {
+        bool bOn = evt.strLabel == strOnEventLabel;
+        if ( bSent ) {
+          bLastValueSent = bOn;
+          failedState = NO_FAILURE;
+          bSendSucceeded = true;
+        } else if ( lastPostedState == (bOn ? 1 : 0) ) { // older commands were replaced anyway
+          failedState = bOn ? 1 : 0;
+        }
+      };
+    }
+
+    ~PowerSwitch() {
+      dispatcher.stop(); // sendDone uses members destroyed before the dispatcher
+    }
 
     virtual PowerSwitch& setOnEventLabel(const string& onLabel) {
       strOnEventLabel = onLabel;
@@ -30,32 +48,40 @@ namespace ifttt {
     }
 
     void setup() override {
-
+      dispatcher.start();
     }
 
+    // last state sent.  Picks up the dispatcher's results: a command it gave up on is an error and pending again.
     bool isOn() const override {
       //TODO - Find way to query samsung smart switch from IFTTT... may need to go directly to Samsung web service
+      int failed = failedState.exchange(NO_FAILURE);
+      if ( failed != NO_FAILURE ) {
+        automation::logBuffer << "FAILED turning " << ( failed ? "ON" : "OFF" ) << " switch '" << name << "' (IFTTT send failed)." << endl;
+        commandFailed(failed == 1);
+        observe(bLastValueSent);
+      } else if ( bSendSucceeded.exchange(false) ) {
+        bError = false;
+      }
       return bLastValueSent;
     }
 
+    // queued for the dispatcher (sent and retried in the background).  A full queue is an error right away, a
+    // failed send once isOn() sees it.
     void setOn(bool bOn) override {
-      bError = false;
       string eventLabel = bOn ? strOnEventLabel : strOffEventLabel;
-      WebHookEvent evt(eventLabel);
-      auto pSession = std::make_unique<WebHookSession>(strIftttKey);
-      for( int i = 0; i < MAX_RETRY_CNT; i++) {
-        try {
-          if (pSession->sendEvent(evt)) {
-            bLastValueSent = bOn;
-            return;
-          }
-        } catch (Poco::Exception &ex)  {
-          automation::logBuffer << "FAILED turning " << ( bOn ? "ON" : "OFF" ) << " switch '" << name << "' (IFTTT host: " << pSession->getHost() << ")." << endl;
-          automation::logBuffer << ex.displayText() << endl;
-        }
+      if ( !dispatcher.post(WebHookEvent(eventLabel)) ) {
+        bError = true;
+        automation::logBuffer << "FAILED turning " << ( bOn ? "ON" : "OFF" ) << " switch '" << name << "' (IFTTT queue full)." << endl;
+      } else {
+        lastPostedState = bOn ? 1 : 0;
       }
-      bError = true;
     }
+
+  protected:
+    static const int NO_FAILURE = -1;
+    std::atomic<int> lastPostedState {UNKNOWN_STATE};
+    mutable std::atomic<int> failedState {NO_FAILURE}; // 1 or 0 for the state of a command the dispatcher gave up on
+    mutable std::atomic<bool> bSendSucceeded {false};
   };
 }
 #endif //SOLAR_IFTTT_TOGGLE_H
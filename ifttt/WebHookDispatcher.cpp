@@ -0,0 +1,126 @@
+
+#include "WebHookDispatcher.h"
+
+#include <Poco/Exception.h>
+
+#include <chrono>
+#include <sstream>
+#include <iostream>
+
+namespace ifttt {
+
+WebHookDispatcher::WebHookDispatcher(const WebHookSession& session) :
+  sender([this](const WebHookEvent& evt) {
+    stringstream log;
+    bool bSent = this->session.sendEvent(evt, log);
+    cout << log.str() << flush;
+    return bSent;
+  }),
+  session(session) {
+}
+
+void WebHookDispatcher::start() {
+  if ( worker.joinable() ) {
+    return;
+  }
+  bStop = false;
+  worker = std::thread(&WebHookDispatcher::run, this);
+}
+
+void WebHookDispatcher::stop(unsigned long timeoutMs) {
+  if ( !worker.joinable() ) {
+    return;
+  }
+  waitUntilIdle(timeoutMs);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    bStop = true;
+  }
+  queueCondition.notify_all();
+  worker.join();
+}
+
+bool WebHookDispatcher::post(const WebHookEvent& evt) {
+  string key = toKey(evt);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned long nowMs = automation::millisecs();
+    if ( key == lastPostedKey && nowMs - lastPostedMs < coalesceWindowMs ) {
+      coalescedCnt++;
+      return true;
+    }
+    if ( queue.size() >= maxQueueSize ) {
+      rejectedCnt++;
+      return false;
+    }
+    queue.push_back(evt);
+    queuedCnt++;
+    lastPostedKey = key;
+    lastPostedMs = nowMs;
+  }
+  queueCondition.notify_all();
+  return true;
+}
+
+bool WebHookDispatcher::waitUntilIdle(unsigned long timeoutMs) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return queueCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]{ return queue.empty() && !bSending; });
+}
+
+string WebHookDispatcher::toKey(const WebHookEvent& evt) {
+  return evt.strLabel + '\x1f' + evt.strValue1 + '\x1f' + evt.strValue2 + '\x1f' + evt.strValue3;
+}
+
+void WebHookDispatcher::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while ( true ) {
+    queueCondition.wait(lock, [this]{ return bStop || !queue.empty(); });
+    if ( bStop ) {
+      return;
+    }
+    WebHookEvent evt = queue.front();
+    queue.pop_front();
+    bSending = true;
+    lock.unlock();
+
+    bool bSent = send(evt);
+    if ( sendDone ) {
+      sendDone(evt, bSent);
+    }
+
+    lock.lock();
+    bSending = false;
+    if ( !bSent && queue.empty() && lastPostedKey == toKey(evt) ) {
+      lastPostedKey.clear(); // posting it again is not a duplicate
+    }
+    queueCondition.notify_all(); // waitUntilIdle()
+  }
+}
+
+bool WebHookDispatcher::send(const WebHookEvent& evt) {
+  unsigned long delayMs = retryDelayMs;
+  for ( unsigned int i = 0; ; i++ ) {
+    try {
+      if ( sender(evt) ) {
+        sentCnt++;
+        return true;
+      }
+      cerr << __PRETTY_FUNCTION__ << " ERROR: IFTTT event '" << evt.strLabel << "' not accepted by " << session.getHost() << endl;
+    } catch (Poco::Exception &ex) {
+      cerr << __PRETTY_FUNCTION__ << " ERROR: IFTTT event '" << evt.strLabel << "' (host: " << session.getHost() << "): " << ex.displayText() << endl;
+    }
+    if ( i >= maxRetryCnt ) {
+      break;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if ( queueCondition.wait_for(lock, std::chrono::milliseconds(delayMs), [this]{ return bStop.load(); }) ) {
+      break;
+    }
+    delayMs *= 2;
+    retryCnt++;
+  }
+  failedCnt++;
+  return false;
+}
+
+}
@@ -0,0 +1,85 @@
+#ifndef IFTTT_WEBHOOKDISPATCHER_H
+#define IFTTT_WEBHOOKDISPATCHER_H
+
+#include "WebHookSession.h"
+#include "WebHookEvent.h"
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace ifttt {
+
+  // Sends webhook events from a worker thread so post() never waits on the network.  Events go into a queue of at
+  // most maxQueueSize and post() rejects events while it is full.  An event equal to the last one posted less than
+  // coalesceWindowMs ago is dropped (unless that one failed).  Failed sends are retried maxRetryCnt times with
+  // doubling delays.  Connections (and their TLS sessions) come from xmonit::HttpClientPool so they are reused.
+  class WebHookDispatcher {
+  public:
+
+    struct Stats {
+      unsigned long queued;     // accepted by post()
+      unsigned long sent;
+      unsigned long failed;     // gave up after maxRetryCnt retries
+      unsigned long retries;
+      unsigned long coalesced;  // duplicates dropped by post()
+      unsigned long rejected;   // queue full
+    };
+
+    size_t maxQueueSize = 32;
+    unsigned long coalesceWindowMs = 10000;
+    unsigned int maxRetryCnt = 2;
+    unsigned long retryDelayMs = 1000;
+
+    // true if sent.  Replaceable for tests, defaults to WebHookSession::sendEvent().
+    std::function<bool(const WebHookEvent&)> sender;
+
+    // final result of each queued event (after retries), called on the worker thread
+    std::function<void(const WebHookEvent&, bool bSent)> sendDone;
+
+    WebHookDispatcher(const WebHookSession& session);
+
+    ~WebHookDispatcher() {
+      stop();
+    }
+
+    void start();
+
+    // sends what is still queued unless it takes longer than timeoutMs
+    void stop(unsigned long timeoutMs = 5000);
+
+    // false if the event was rejected because the queue is full (a coalesced duplicate counts as posted)
+    bool post(const WebHookEvent& evt);
+
+    // for tests and shutdown: true once the queue is empty and nothing is being sent
+    bool waitUntilIdle(unsigned long timeoutMs);
+
+    Stats getStats() const {
+      return { queuedCnt, sentCnt, failedCnt, retryCnt, coalescedCnt, rejectedCnt };
+    }
+
+  protected:
+    WebHookSession session;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::deque<WebHookEvent> queue;
+    string lastPostedKey;
+    unsigned long lastPostedMs = 0;
+    bool bSending = false;
+    std::atomic<bool> bStop {false};
+    std::atomic<unsigned long> queuedCnt {0}, sentCnt {0}, failedCnt {0}, retryCnt {0}, coalescedCnt {0}, rejectedCnt {0};
+
+    static string toKey(const WebHookEvent& evt);
+
+    void run();
+
+    // with retries, returns true if sent
+    bool send(const WebHookEvent& evt);
+  };
+}
+#endif
@@ -3,10 +3,12 @@
 
 #include "WebHookEvent.h"
 #include "../automation/Automation.h"
+#include "../xmonit/HttpClientPool.h"
 #include <Poco/Net/HTTPSClientSession.h>
 #include <Poco/Net/HTTPRequest.h>
 #include <Poco/Net/HTTPResponse.h>
 #include <Poco/StreamCopier.h>
+#include <Poco/JSON/Object.h>
 #include <string>
 #include <iostream>
 #include <Poco/DateTimeFormatter.h>
@@ -18,45 +20,65 @@ using namespace std;
 
 namespace ifttt {
 
-  class WebHookSession : public HTTPSClientSession {
+  // Connections come from xmonit::HttpClientPool so they are kept open between events
+  class WebHookSession {
 
   public:
     string strKey;
+    string host;
+    unsigned short port;
+    bool bSecure;
 
-    WebHookSession(const string &iftttKey) :
-        HTTPSClientSession("maker.ifttt.com"),
-        strKey(iftttKey) {
-      setKeepAlive(true);
+    WebHookSession(const string &iftttKey, const string& host = "maker.ifttt.com",
+                   unsigned short port = HTTPSClientSession::HTTPS_PORT, bool bSecure = true) :
+        strKey(iftttKey), host(host), port(port), bSecure(bSecure) {
     }
 
-    bool sendEvent(const WebHookEvent &evt) {
+    string getHost() const {
+      return host;
+    }
+
+    // values are escaped since they can hold device titles and log text
+    static string toJson(const WebHookEvent &evt) {
+      Poco::JSON::Object body;
+      body.set("value1", evt.strValue1);
+      body.set("value2", evt.strValue2);
+      body.set("value3", evt.strValue3);
+      stringstream ss;
+      body.stringify(ss);
+      return ss.str();
+    }
+
+    // log is automation::logBuffer on the main loop thread (not thread safe so workers pass their own)
+    bool sendEvent(const WebHookEvent &evt, ostream& log = automation::logBuffer) {
       std::string strPath("/trigger/");
       strPath += evt.strLabel + "/with/key/" + strKey;
       HTTPRequest req(HTTPRequest::HTTP_POST, strPath);
       req.setContentType("application/json");
       //req.setKeepAlive(true);
-      string reqBody = "{\"value1\":\"";
-      reqBody += evt.strValue1 + "\",\"value2\":\"" + evt.strValue2 + "\",\"value3\":\"" + evt.strValue3 + "\"}";
+      string reqBody = toJson(evt);
       req.setContentLength(reqBody.length());
 
-      automation::logBuffer << ">>>>> BEGIN IFTTT WebHook Request @ " << DateTimeFormatter::format(LocalDateTime(), DateTimeFormat::SORTABLE_FORMAT) << " <<<<<" << endl;
+      log << ">>>>> BEGIN IFTTT WebHook Request @ " << DateTimeFormatter::format(LocalDateTime(), DateTimeFormat::SORTABLE_FORMAT) << " <<<<<" << endl;
       stringstream ss;
       req.write(ss);
       string requestLine1;
       getline(ss,requestLine1);
       requestLine1.erase(remove(requestLine1.begin(), requestLine1.end(), '\r'), requestLine1.end());      
-      automation::logBuffer << requestLine1 << endl;
+      log << requestLine1 << endl;
       //cout << reqBody << endl;
 
-      ostream &os = sendRequest(req);
+      xmonit::HttpClientPool::Lease pSession = xmonit::HttpClientPool::instance.acquire(host, port, bSecure);
+      ostream &os = pSession->sendRequest(req);
       os << reqBody;
 
       HTTPResponse resp;
-      istream &is = receiveResponse(resp);
+      istream &is = pSession->receiveResponse(resp);
       string strResp;
       Poco::StreamCopier::copyToString(is, strResp);
-      automation::logBuffer << "response: " << strResp << endl;
-      automation::logBuffer << ">>>>> END IFTTT WebHook Request" << "<<<<<" << endl;
+      pSession.done();
+      log << "response: " << strResp << endl;
+      log << ">>>>> END IFTTT WebHook Request" << "<<<<<" << endl;
       return resp.getStatus() == HTTPResponse::HTTPStatus::HTTP_OK;
     }
   };
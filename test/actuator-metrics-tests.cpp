@@ -0,0 +1,79 @@
+
+#include "automation/Automation.h"
+#include "xmonit/ActuatorMetrics.h"
+
+#include <Poco/Exception.h>
+
+#include <iostream>
+
+using namespace std;
+using namespace xmonit;
+
+
+struct ActuatorMetricsTests {
+
+  static void check(const string& name, unsigned long actual, unsigned long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: ActuatorMetrics " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  // within the ~3% bucket precision
+  static void checkNear(const string& name, unsigned long actual, unsigned long expected) {
+    if ( actual < expected || actual > expected + expected / 32 ) {
+      cout << "FAILED: ActuatorMetrics " << name << " expected about " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    LatencyHistogram histogram;
+    check("empty percentile", histogram.getPercentile(50), 0);
+    for ( unsigned long us = 1; us <= 10000; us++ ) {
+      histogram.record(us * 100); // 0.1ms to 1s
+    }
+    check("count", histogram.getCount(), 10000);
+    checkNear("p50", histogram.getPercentile(50), 500000);
+    checkNear("p95", histogram.getPercentile(95), 950000);
+    checkNear("p99", histogram.getPercentile(99), 990000);
+    check("p100 is max", histogram.getPercentile(100), 1000000);
+    check("max", histogram.getMax(), 1000000);
+
+    LatencyHistogram smallHistogram;
+    smallHistogram.record(3);
+    smallHistogram.record(7);
+    check("small values exact", smallHistogram.getPercentile(50), 3);
+    smallHistogram.record(LatencyHistogram::MAX_US + 1);
+    check("value over max counted", smallHistogram.getCount(), 3);
+
+    ActuatorMetrics metrics;
+    unsigned long listenerCnt = 0;
+    metrics.listener = [&](const string&, ActuatorMetrics::Result, unsigned long) { listenerCnt++; };
+    {
+      ActuatorMetrics::Call call("fan", metrics);
+      call.done(ActuatorMetrics::Result::Ok);
+    }
+    {
+      ActuatorMetrics::Call call("fan", metrics);
+      call.done(Poco::TimeoutException("stand-in"));
+    }
+    {
+      ActuatorMetrics::Call call("pump", metrics); // not done (exception) so error
+    }
+    vector<ActuatorMetrics::Snapshot> snapshots = metrics.getSnapshots();
+    check("actuators", snapshots.size(), 2);
+    if ( snapshots.size() == 2 ) {
+      check("fan calls", snapshots[0].count, 2);
+      check("fan ok", snapshots[0].resultCnts[(int)ActuatorMetrics::Result::Ok], 1);
+      check("fan timeout", snapshots[0].resultCnts[(int)ActuatorMetrics::Result::Timeout], 1);
+      check("pump error", snapshots[1].resultCnts[(int)ActuatorMetrics::Result::Error], 1);
+    }
+    check("listener calls", listenerCnt, 3);
+    check("parse error", (int)ActuatorMetrics::classify(Poco::SyntaxException("stand-in")), (int)ActuatorMetrics::Result::ParseError);
+    check("http status", (int)ActuatorMetrics::classifyHttpStatus(404), (int)ActuatorMetrics::Result::HttpError);
+
+    cout << "ActuatorMetrics tests complete" << endl;
+  }
+};
@@ -0,0 +1,94 @@
+
+#include "automation/Automation.h"
+#include "automation/device/PowerAllocator.h"
+#include "automation/constraint/EvaluationContext.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <cstdlib>
+
+using namespace std;
+using namespace automation;
+
+
+struct PowerAllocatorTests {
+
+    struct TestSwitch : public automation::PowerSwitch {
+      bool bOn {false};
+      RTTI_GET_TYPE_IMPL(automation::test,TestSwitch)
+      TestSwitch(const string& name, float requiredWatts) : PowerSwitch(name,requiredWatts) {}
+      bool isOn() const override { return bOn; }
+      void setOn(bool bOn) override { this->bOn = bOn; }
+      void setup() override {}
+    };
+
+public:
+
+  static void run() {
+
+    const int loadCnt = 100, tickCnt = 1000;
+    vector<unique_ptr<TestSwitch>> switches;
+    PowerAllocator allocator;
+    allocator.minVoltage = 24;
+    srand(1);
+    for( int i = 0; i < loadCnt; i++ ) {
+      switches.emplace_back(new TestSwitch("load " + to_string(i), 50 + rand() % 500));
+      allocator.add(switches.back().get(), nullptr, rand() % 3, 5*MINUTES, 2*MINUTES);
+    }
+
+    unsigned long nowMs = automation::millisecs();
+    auto start = chrono::steady_clock::now();
+    for( int i = 0; i < tickCnt; i++ ) {
+      nowMs += 15*SECONDS;
+      allocator.allocate(5000 + rand() % 10000, {95, 26.5}, nowMs);
+      for ( auto& pSwitch : switches ) {
+        if ( pSwitch->isOn() != allocator.isAllocated(pSwitch.get()) ) {
+          pSwitch->toggle.setValue(allocator.isAllocated(pSwitch.get()));
+          pSwitch->flush();
+        }
+      }
+    }
+    double avgMs = chrono::duration<double,milli>(chrono::steady_clock::now() - start).count() / tickCnt;
+    cout << "PowerAllocator " << loadCnt << " loads: " << avgMs << "ms per tick (includes toggling)" << endl;
+    if ( avgMs >= 1.0 ) {
+      cout << "FAILED: PowerAllocator slower than 1ms per tick" << endl;
+    }
+
+    allocator.allocate(10000, {95, 23.0}, nowMs);
+    for ( auto& pSwitch : switches ) {
+      if ( allocator.isAllocated(pSwitch.get()) ) {
+        cout << "FAILED: " << pSwitch->name << " allocated with low battery voltage" << endl;
+      }
+    }
+
+    // what if: allocation from the context's input power without touching the live allocation
+    static float inputWatts = 300;
+    static SensorFn inputPower("input power", [](){ return inputWatts; });
+    static SensorFn soc("soc", [](){ return 50.0f; });
+    static SensorFn voltage("voltage", [](){ return 26.0f; });
+    inputPower.setCacheable(false);
+    PowerAllocator whatIfAllocator;
+    whatIfAllocator.minVoltage = 24;
+    whatIfAllocator.pInputWatts = &inputPower;
+    whatIfAllocator.pSoc = &soc;
+    whatIfAllocator.pVoltage = &voltage;
+    TestSwitch hvac("hvac", 1000);
+    whatIfAllocator.add(&hvac, nullptr);
+    AllocationConstraint allocated(&whatIfAllocator, &hvac);
+    whatIfAllocator.allocate(inputWatts, {50, 26}, automation::millisecs());
+    EvaluationContext ctx;
+    ctx.setValue(&inputPower, 1500);
+    if ( !allocated.evaluate(ctx) ) {
+      cout << "FAILED: PowerAllocator what if allocation expected 1 but was 0" << endl;
+    }
+    if ( whatIfAllocator.isAllocated(&hvac) ) {
+      cout << "FAILED: PowerAllocator live allocation changed by what if" << endl;
+    }
+    ctx.setValue(&voltage, 23);
+    ctx.clearStates();
+    if ( allocated.evaluate(ctx) ) {
+      cout << "FAILED: PowerAllocator what if allocation with low voltage expected 0 but was 1" << endl;
+    }
+  }
+};
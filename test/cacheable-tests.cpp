@@ -0,0 +1,139 @@
+
+#include "automation/Automation.h"
+#include "automation/Cacheable.h"
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace automation;
+
+
+struct CacheableTests {
+
+  // loads nextValue unless bFailing.  Loads wait while bBlocked so tests can overlap callers with a load.
+  struct TestCache : public AsyncCacheable<float> {
+    std::atomic<float> nextValue {1};
+    std::atomic<bool> bFailing {false};
+    std::atomic<bool> bBlocked {false};
+    std::atomic<int> loadCnt {0}, activeCnt {0}, maxActiveCnt {0};
+
+    TestCache(unsigned long softTtlMs, unsigned long hardTtlMs) : AsyncCacheable<float>(softTtlMs, hardTtlMs, NAN) {}
+
+    ~TestCache() {
+      joinRefresh();
+    }
+
+    bool loadValue(float& loadedValue) const override {
+      TestCache* pThis = const_cast<TestCache*>(this);
+      int active = ++pThis->activeCnt;
+      if ( active > maxActiveCnt ) {
+        pThis->maxActiveCnt = active;
+      }
+      while ( bBlocked ) {
+        automation::sleep(1);
+      }
+      pThis->loadCnt++;
+      pThis->activeCnt--;
+      loadedValue = nextValue;
+      return !bFailing;
+    }
+
+    // wait for a background refresh started by getCachedValue()
+    void waitForLoads(int cnt) {
+      for ( int i = 0; i < 200 && loadCnt < cnt; i++ ) {
+        automation::sleep(5);
+      }
+      joinRefresh();
+    }
+  };
+
+  static void check(const string& name, float actual, float expected) {
+    if ( actual != expected && !(std::isnan(actual) && std::isnan(expected)) ) {
+      cout << "FAILED: Cacheable " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void runTtlTests() {
+
+    TestCache cache(50, 300);
+    check("first load on caller", cache.getCachedValue(), 1);
+    check("loaded once", cache.loadCnt, 1);
+    cache.nextValue = 2;
+    check("cached before soft ttl", cache.getCachedValue(), 1);
+    check("no load before soft ttl", cache.loadCnt, 1);
+
+    automation::sleep(60);
+    check("old value after soft ttl", cache.getCachedValue(), 1);
+    cache.waitForLoads(2);
+    check("refreshed in background", cache.getCachedValue(), 2);
+
+    cache.bFailing = true;
+    cache.nextValue = NAN;
+    automation::sleep(60);
+    cache.getCachedValue();
+    cache.waitForLoads(3);
+    check("failed load keeps value", cache.getCachedValue(), 2);
+    check("failed load counted", cache.getFailedLoadCount(), 1);
+    check("failed load not a fresh result", cache.getLoadCount(), 2);
+    check("no retry before soft ttl", cache.loadCnt, 3);
+    check("not stale yet", cache.isStale(), false);
+
+    for ( int i = 0; i < 100 && !cache.isStale(); i++ ) {
+      cache.getCachedValue(); // keeps retrying every soft ttl
+      automation::sleep(10);
+    }
+    check("stale after hard ttl", cache.isStale(), true);
+    check("stale value", cache.getCachedValue(), NAN);
+
+    cache.bFailing = false;
+    cache.nextValue = 3;
+    automation::sleep(60);
+    cache.getCachedValue();
+    cache.waitForLoads(cache.loadCnt + 1);
+    check("recovered", cache.getCachedValue(), 3);
+
+    TestCache failingCache(50, 300);
+    failingCache.bFailing = true;
+    check("failed first load", failingCache.getCachedValue(), NAN);
+    check("failed first load is stale", failingCache.isStale(), true);
+    check("first failure not retried right away", failingCache.getCachedValue(), NAN);
+    check("one attempt", failingCache.loadCnt, 1);
+  }
+
+  static void runSingleFlightTests() {
+
+    TestCache cache(10, 1000);
+    cache.getCachedValue();
+    automation::sleep(20);
+    cache.bBlocked = true;
+    vector<std::thread> callers;
+    for ( int i = 0; i < 8; i++ ) {
+      callers.emplace_back([&cache]() {
+        for ( int j = 0; j < 20; j++ ) {
+          cache.getCachedValue();
+          automation::sleep(1);
+        }
+      });
+    }
+    for ( auto& caller : callers ) {
+      caller.join();
+    }
+    check("callers not blocked by refresh", cache.loadCnt, 1);
+    cache.bBlocked = false;
+    cache.waitForLoads(2);
+    check("one load at a time", cache.maxActiveCnt, 1);
+    check("one refresh for all callers", cache.loadCnt, 2);
+  }
+
+public:
+
+  static void run() {
+    runTtlTests();
+    runSingleFlightTests();
+    cout << "Cacheable tests complete" << endl;
+  }
+};
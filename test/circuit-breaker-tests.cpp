@@ -0,0 +1,50 @@
+
+#include "automation/Automation.h"
+#include "automation/CircuitBreaker.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace automation;
+
+
+struct CircuitBreakerTests {
+
+  static void check(const string& name, bool bPassed) {
+    if ( !bPassed ) {
+      cout << "FAILED: CircuitBreaker " << name << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    CircuitBreaker breaker(2, 1000, 3000);
+    unsigned long nowMs = 100000;
+
+    check("closed at start", breaker.allow(nowMs) && breaker.getState() == CircuitBreaker::State::Closed);
+    breaker.failed(nowMs);
+    check("closed below threshold", breaker.allow(nowMs));
+    breaker.failed(nowMs);
+    check("open at threshold", !breaker.allow(nowMs) && breaker.getState() == CircuitBreaker::State::Open);
+    check("retry in", breaker.getRetryInMs(nowMs + 400) == 600);
+
+    nowMs += 1000;
+    check("half open after open period", breaker.allow(nowMs) && breaker.getState() == CircuitBreaker::State::HalfOpen);
+    breaker.failed(nowMs);
+    check("failed trial opens again", !breaker.allow(nowMs + 1999));
+    check("failed trial doubles open period", breaker.allow(nowMs + 2000));
+    breaker.failed(nowMs += 2000);
+    check("open period limited to maxOpenMs", !breaker.allow(nowMs + 2999) && breaker.allow(nowMs + 3000));
+
+    breaker.succeeded();
+    check("closed after success", breaker.getState() == CircuitBreaker::State::Closed && breaker.getFailureCount() == 0);
+    breaker.failed(nowMs);
+    breaker.record(false, nowMs);
+    check("open period starts over after success", !breaker.allow(nowMs + 999) && breaker.allow(nowMs + 1000));
+    check("open count", breaker.getOpenCount() == 4);
+
+    cout << "CircuitBreaker tests complete" << endl;
+  }
+};
@@ -11,6 +11,7 @@
 #include "automation/constraint/ValueConstraint.h"
 #include "automation/constraint/ToggleConstraint.h"
 #include "automation/constraint/SimultaneousConstraint.h"
+#include "automation/constraint/StartCoordinator.h"
 #include "automation/constraint/TimeRangeConstraint.h"
 #include "automation/constraint/TransitionDurationConstraint.h"
 
@@ -27,18 +28,74 @@ using namespace automation;
 struct ConstraintTests {
 
     struct TestToggle : public automation::Toggle {
-      double v {0};
+      float v {0};
       public:
       TestToggle() : automation::Toggle(nullptr) {}
-      virtual double getValueImpl() const { return v; }
-      virtual bool setValueImpl(double dVal) { v = dVal; }
+      float getValueImpl() const override { return v; }
+      bool setValueImpl(float dVal) override { v = dVal; return true; }
     };
 
+    static void check(const string& name, long actual, long expected) {
+      if ( actual != expected ) {
+        cout << "FAILED: StartCoordinator " << name << " expected " << expected << " but was " << actual << endl;
+      }
+    }
+
+    // starts are recorded with millisecs() so request times are offsets from it
+    static void runStartCoordinatorTests() {
+
+      TestToggle hvac, lights, pump;
+      StartCoordinator coordinator{30*SECONDS};
+      coordinator.add(&hvac);
+      coordinator.add(&lights);
+      coordinator.add(&pump);
+      unsigned long nowMs = millisecs();
+      check("first start", coordinator.requestStart(&lights, 0, 0, true, nowMs), true);
+      lights.setValue(true);
+      check("start cancels request", coordinator.waitingCount(nowMs), 0);
+      check("spacing", coordinator.requestStart(&pump, 0, 0, true, nowMs + 1000), false);
+      check("longer device spacing", coordinator.requestStart(&pump, 0, 45*SECONDS, true, nowMs + 31*SECONDS), false);
+      check("after spacing", coordinator.requestStart(&pump, 0, 0, true, nowMs + 31*SECONDS), true);
+      lights.setValue(false);
+      check("stopped load not counted", coordinator.requestStart(&pump, 0, 45*SECONDS, true, nowMs + 1000), true);
+
+      StartCoordinator queue{30*SECONDS};
+      nowMs = millisecs();
+      check("lower priority first in line", queue.requestStart(&pump, 0, 0, true, nowMs), true);
+      check("higher priority ready", queue.requestStart(&hvac, 1, 0, true, nowMs + 1000), true);
+      check("lower priority waits", queue.requestStart(&pump, 0, 0, true, nowMs + 2000), false);
+      queue.requestStart(&hvac, 1, 0, false, nowMs + 3000);
+      check("not ready does not block", queue.requestStart(&pump, 0, 0, true, nowMs + 4000), true);
+      queue.requestStart(&hvac, 1, 0, true, nowMs + 5000);
+      unsigned long expiredMs = nowMs + 5000 + queue.requestTtlMs + 1;
+      check("expired request does not block", queue.requestStart(&pump, 0, 0, true, expiredMs), true);
+      check("same priority later requester", queue.requestStart(&lights, 0, 0, true, expiredMs + 1), false);
+      check("same priority waits longest", queue.canStart(&pump, 0, 0, expiredMs + 2), true);
+
+      TestToggle hvac2, lights2;
+      StartCoordinator startCoordinator{30*SECONDS};
+      BooleanConstraint hvacReady(false);
+      SimultaneousConstraint hvacSimultaneous(2*MINUTES, &hvac2), lightsSimultaneous(30*SECONDS, &lights2);
+      hvacSimultaneous.setCoordinator(&startCoordinator, 1, {&hvacReady});
+      lightsSimultaneous.setCoordinator(&startCoordinator, 0);
+      check("waiting on prerequisites", hvacSimultaneous.checkValue(), false);
+      check("not held back by unready", lightsSimultaneous.checkValue(), false);
+      hvacReady.overrideTestResult(true);
+      check("ready requester not blocked", hvacSimultaneous.checkValue(), false);
+      check("held back by higher priority", lightsSimultaneous.checkValue(), true);
+      hvac2.setValue(true);
+      check("held back by spacing", lightsSimultaneous.checkValue(), true);
+      check("started device not blocked", hvacSimultaneous.checkValue(), false);
+      check("coordinator title", hvacSimultaneous.getTitle().find("Simultaneous") == 0, true);
+    }
+
 public:
 
 
   static void run() {
 
+    runStartCoordinatorTests();
+
     TestToggle t1, t2, t3, t4;
     SimultaneousConstraint c1(15*SECONDS,&t1);
     SimultaneousConstraint c2(15*SECONDS,&t2);
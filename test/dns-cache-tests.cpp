@@ -0,0 +1,80 @@
+
+#include "automation/Automation.h"
+#include "xmonit/DnsCache.h"
+
+#include <Poco/Net/NetException.h>
+
+#include <atomic>
+#include <iostream>
+
+using namespace std;
+using namespace xmonit;
+
+
+struct DnsCacheTests {
+
+  // resolver stand-in: "solar" is 10.0.0.5 until bFailing is set, other hosts do not exist
+  struct FakeDns {
+    std::atomic<bool> bFailing {false};
+    string operator()(const string& host) {
+      if ( bFailing || host != "solar" ) {
+        throw Poco::Net::HostNotFoundException(host);
+      }
+      return "10.0.0.5";
+    }
+  };
+
+  static FakeDns& fakeDns() {
+    static FakeDns dns;
+    return dns;
+  }
+
+  static void check(const string& name, unsigned long actual, unsigned long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: DnsCache " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void check(const string& name, const string& actual, const string& expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: DnsCache " << name << " expected '" << expected << "' but was '" << actual << "'" << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    DnsCache cache(20);
+    cache.resolver = [](const string& host) { return fakeDns()(host); };
+
+    check("first lookup", cache.resolve("solar"), "10.0.0.5");
+    check("cached lookup", cache.resolve("solar"), "10.0.0.5");
+    check("lookups while cached", cache.getStats().lookups, 1);
+
+    fakeDns().bFailing = true;
+    automation::sleep(30);
+    check("expired lookup returns cached address", cache.resolve("solar"), "10.0.0.5"); // refresh in background
+    for ( int i = 0; i < 100 && cache.getStats().stale == 0; i++ ) {
+      automation::sleep(10);
+    }
+    check("stale address after failure", cache.resolve("solar"), "10.0.0.5");
+    check("failures", cache.getStats().failures, 1);
+    check("stale", cache.getStats().stale, 1);
+
+    check("unknown host", cache.resolve("openhab"), "");
+    check("unknown host again", cache.resolve("openhab"), "");
+    check("unknown host looked up every time", cache.getStats().failures, 3);
+
+    fakeDns().bFailing = false;
+    automation::sleep(30);
+    cache.resolve("solar");
+    for ( int i = 0; i < 100 && cache.getStats().lookups < 5; i++ ) {
+      automation::sleep(10);
+    }
+    check("recovered lookup", cache.resolve("solar"), "10.0.0.5");
+    check("stale after recovery", cache.getStats().stale, 1);
+
+    cout << "DnsCache tests complete" << endl;
+  }
+};
@@ -0,0 +1,112 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/Sensor.h"
+#include "automation/sensor/FilterSensor.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace automation;
+
+
+struct FilterSensorTests {
+
+  static float& rawValue() {
+    static float rawValue = 0;
+    return rawValue;
+  }
+
+  static void check(const string& name, float actual, float expected) {
+    if ( fabs(actual - expected) > 0.0001 && !(isnan(actual) && isnan(expected)) ) {
+      cout << "FAILED: FilterSensor " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void runHampelTests() {
+
+    HampelStage<5> hampel(3, 0.05);
+    check("first reading passed", hampel.apply(24), 24);
+    check("passed until 3 readings", hampel.apply(30), 30);
+    hampel.reset();
+    for ( float val : {24.0f, 24.02f, 23.98f, 24.0f, 24.01f} ) {
+      hampel.apply(val);
+    }
+    check("outlier replaced by median", hampel.apply(18), 24);
+    check("small change within min deviation", hampel.apply(24.1), 24.1);
+    check("nan passed through", hampel.apply(NAN), NAN);
+
+    // a real step is held back until it fills half of the window
+    hampel.reset();
+    for ( int i = 0; i < 5; i++ ) {
+      hampel.apply(25);
+    }
+    check("step held 1", hampel.apply(23), 25);
+    check("step held 2", hampel.apply(23), 25);
+    check("step held 3", hampel.apply(23), 25);
+    check("step accepted", hampel.apply(23), 23);
+
+    HampelStage<5> noisy(3);
+    for ( float val : {20.0f, 22.0f, 18.0f, 21.0f, 19.0f} ) {
+      noisy.apply(val);
+    }
+    check("within noisy window deviation", noisy.apply(23), 23);
+    check("outside noisy window deviation", noisy.apply(40), 21);
+  }
+
+  static void runStageTests() {
+
+    CalibrationStage calibration(0.965);
+    check("scaled", calibration.apply(1000), 965);
+    CalibrationStage offset(2, -1);
+    check("scaled and offset", offset.apply(3), 5);
+    check("calibrated nan", offset.apply(NAN), NAN);
+
+    ClampStage clamp(0, 100);
+    check("clamped low", clamp.apply(-5), 0);
+    check("clamped high", clamp.apply(150), 100);
+    ClampStage reject(0, 100, true);
+    check("rejected", reject.apply(-5), NAN);
+    check("in range", reject.apply(50), 50);
+
+    MedianStage<3> median;
+    median.apply(1);
+    median.apply(10);
+    check("median", median.apply(2), 2);
+  }
+
+  // stages run in list order on each refresh of the filter sensor
+  static void runChainTests() {
+
+    static SensorFn raw("raw", [](){ return rawValue(); });
+    raw.setCacheable(false);
+    CalibrationStage scale(10);
+    ClampStage clamp(0, 50);
+    FilterSensor scaledThenClamped("scaled then clamped", raw, {&scale, &clamp});
+    FilterSensor clampedThenScaled("clamped then scaled", raw, {&clamp, &scale});
+
+    rawValue() = 8;
+    check("scale first", scaledThenClamped.reset().getValue(), 50);
+    check("clamp first", clampedThenScaled.reset().getValue(), 80);
+
+    HampelStage<5> outliers(3, 0.05);
+    CalibrationStage calibration(2);
+    FilterSensor filtered("filtered", raw, {&outliers, &calibration});
+    for ( float val : {24.0f, 24.0f, 24.0f, 24.0f} ) {
+      rawValue() = val;
+      filtered.reset().getValue();
+    }
+    rawValue() = 10;
+    check("outlier replaced then calibrated", filtered.reset().getValue(), 48);
+    check("cached between refreshes", filtered.getValue(), 48);
+  }
+
+public:
+
+  static void run() {
+    runHampelTests();
+    runStageTests();
+    runChainTests();
+    cout << "FilterSensor tests complete" << endl;
+  }
+};
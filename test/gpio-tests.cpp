@@ -0,0 +1,70 @@
+
+#include "automation/Automation.h"
+#include "xmonit/GpioPowerSwitch.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+using namespace xmonit;
+
+
+struct GpioTests {
+
+  static string readFile(const string& path) {
+    ifstream is(path);
+    string text;
+    getline(is, text);
+    return text;
+  }
+
+public:
+
+  static void run() {
+
+    char dirTemplate[] = "/tmp/gpioXXXXXX";
+    string root = mkdtemp(dirTemplate);
+    MockGpioBackend gpio(root);
+
+    GpioPowerSwitch powerSwitch("Test Lights", 15, 100, &gpio);
+    powerSwitch.setup();
+    if ( powerSwitch.bError || readFile(gpio.getPinPath(15)) != "0" || powerSwitch.isOn() ) {
+      cout << "FAILED: GpioPowerSwitch setup did not make pin an output that is off" << endl;
+    }
+    powerSwitch.setOn(true);
+    if ( readFile(gpio.getPinPath(15)) != "1" || !powerSwitch.isOn() || powerSwitch.bError ) {
+      cout << "FAILED: GpioPowerSwitch setOn(true) not written" << endl;
+    }
+    ofstream(gpio.getPinPath(15)) << "0\n"; // changed outside the app
+    if ( powerSwitch.isOn() ) {
+      cout << "FAILED: GpioPowerSwitch isOn did not read pin" << endl;
+    }
+
+    ofstream(gpio.getPinPath(16)) << "1\n"; // still on from before a restart
+    GpioPowerSwitch latchedSwitch("Latched", 16, 0, &gpio);
+    latchedSwitch.setup();
+    if ( latchedSwitch.bError || !latchedSwitch.isOn() ) {
+      cout << "FAILED: GpioPowerSwitch setup should keep a pin that is on" << endl;
+    }
+
+    GpioPowerSwitch missingPinSwitch("Missing", 3, 0, &gpio);
+    if ( missingPinSwitch.isOn() || !missingPinSwitch.bError ) {
+      cout << "FAILED: GpioPowerSwitch unreadable pin should be an error" << endl;
+    }
+
+    CharDevGpioBackend noChip(root + "/gpiochip9");
+    if ( noChip.isOpen() || noChip.read(15) != -1 || noChip.write(15, true) ) {
+      cout << "FAILED: CharDevGpioBackend missing chip should fail" << endl;
+    }
+    if ( string(GpioBackend::create("chardev", root + "/gpiochip9")->getName()) != "exec" ) {
+      cout << "FAILED: GpioBackend missing chip should fall back to exec" << endl;
+    }
+
+    if ( GpioBackend::wiringPiToBcm(15) != 14 || GpioBackend::wiringPiToBcm(0) != 17 || GpioBackend::wiringPiToBcm(32) != -1 ) {
+      cout << "FAILED: GpioBackend wiringPiToBcm" << endl;
+    }
+
+    cout << "Gpio tests complete" << endl;
+  }
+};
@@ -0,0 +1,134 @@
+
+#include "automation/Automation.h"
+#include "xmonit/HttpClientPool.h"
+
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/StreamCopier.h>
+#include <Poco/Exception.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+using namespace std;
+using namespace xmonit;
+
+
+struct HttpClientPoolTests {
+
+  struct OkHandler : public Poco::Net::HTTPRequestHandler {
+    void handleRequest(Poco::Net::HTTPServerRequest& req, Poco::Net::HTTPServerResponse& resp) override {
+      resp.setContentType("text/plain");
+      resp.sendBuffer("OK", 2);
+    }
+  };
+
+  struct OkHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& req) override {
+      return new OkHandler;
+    }
+  };
+
+  static string get(HttpClientPool& pool, unsigned short port, bool bDone = true) {
+    HttpClientPool::Lease pSession = pool.acquire("127.0.0.1", port);
+    Poco::Net::HTTPRequest req(Poco::Net::HTTPRequest::HTTP_GET, "/", Poco::Net::HTTPRequest::HTTP_1_1);
+    pSession->sendRequest(req);
+    Poco::Net::HTTPResponse resp;
+    string body;
+    Poco::StreamCopier::copyToString(pSession->receiveResponse(resp), body);
+    if ( bDone ) {
+      pSession.done();
+    }
+    return body;
+  }
+
+  static void check(const string& name, unsigned long actual, unsigned long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: HttpClientPool " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    Poco::Net::ServerSocket socket(0);
+    Poco::Net::HTTPServer server(new OkHandlerFactory, socket, new Poco::Net::HTTPServerParams);
+    server.start();
+    unsigned short port = socket.address().port();
+
+    HttpClientPool pool;
+    pool.maxConnectionsPerHost = 2;
+    pool.connectTimeoutMs = 100;
+
+    if ( get(pool, port) != "OK" || get(pool, port) != "OK" ) {
+      cout << "FAILED: HttpClientPool unexpected response" << endl;
+    }
+    check("connects after two requests", pool.getStats().connects, 1);
+    check("reuses after two requests", pool.getStats().reuses, 1);
+
+    get(pool, port, false); // not done so the connection is closed
+    get(pool, port);
+    check("discards", pool.getStats().discards, 1);
+    check("connects after discard", pool.getStats().connects, 2);
+
+    {
+      HttpClientPool::Lease pFirst = pool.acquire("127.0.0.1", port);
+      HttpClientPool::Lease pSecond = pool.acquire("127.0.0.1", port);
+      try {
+        pool.acquire("127.0.0.1", port);
+        cout << "FAILED: HttpClientPool allowed more than maxConnectionsPerHost" << endl;
+      } catch (Poco::TimeoutException& ex) {
+      }
+      pFirst.done();
+      pSecond.done();
+    }
+    check("timeouts", pool.getStats().timeouts, 1);
+    check("leases", pool.getStats().leases, 6);
+
+    pool.keepAliveMs = 0;
+    automation::sleep(5);
+    get(pool, port);
+    check("connects after keep alive expired", pool.getStats().connects, 4);
+
+    // a release wakes the waiter for that host even when another host's waiter is first in line
+    Poco::Net::ServerSocket otherSocket(0);
+    Poco::Net::HTTPServer otherServer(new OkHandlerFactory, otherSocket, new Poco::Net::HTTPServerParams);
+    otherServer.start();
+    unsigned short otherPort = otherSocket.address().port();
+    pool.maxConnectionsPerHost = 1;
+    pool.connectTimeoutMs = 2000;
+    {
+      std::unique_ptr<HttpClientPool::Lease> pBusy(new HttpClientPool::Lease(pool.acquire("127.0.0.1", port)));
+      std::unique_ptr<HttpClientPool::Lease> pOther(new HttpClientPool::Lease(pool.acquire("127.0.0.1", otherPort)));
+      std::atomic<bool> bOtherAcquired {false};
+      std::thread busyWaiter([&]() { pool.acquire("127.0.0.1", port).done(); });
+      automation::sleep(50);
+      std::thread otherWaiter([&]() { pool.acquire("127.0.0.1", otherPort).done(); bOtherAcquired = true; });
+      automation::sleep(50);
+      pOther->done();
+      pOther.reset();
+      for ( int i = 0; i < 100 && !bOtherAcquired; i++ ) {
+        automation::sleep(5);
+      }
+      check("other host waiter woken", bOtherAcquired, true);
+      pBusy->done();
+      pBusy.reset();
+      busyWaiter.join();
+      otherWaiter.join();
+    }
+    otherServer.stop();
+
+    server.stop();
+    cout << "HttpClientPool tests complete" << endl;
+  }
+};
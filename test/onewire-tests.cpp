@@ -0,0 +1,82 @@
+
+#include "automation/Automation.h"
+#include "xmonit/OneWireBus.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace xmonit;
+
+
+struct OneWireBusTests {
+
+  // fake /sys/bus/w1/devices tree
+  static void writeFile(const string& path, const string& text) {
+    ofstream(path) << text;
+  }
+
+  static string readFile(const string& path) {
+    ifstream is(path);
+    string text;
+    getline(is, text);
+    return text;
+  }
+
+  static void check(const string& name, float actual, float expected) {
+    if ( isnan(expected) ? !isnan(actual) : fabs(actual - expected) > 0.0005 ) {
+      cout << "FAILED: OneWireBus " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    char dirTemplate[] = "/tmp/w1-devicesXXXXXX";
+    string root = mkdtemp(dirTemplate);
+    mkdir((root + "/w1_bus_master1").c_str(), 0755);
+    writeFile(root + "/w1_bus_master1/therm_bulk_read", "");
+    const char* probeIds[] = { "28-000000000001", "28-000000000002", "28-000000000003", "28-000000000004" };
+    for ( const char* id : probeIds ) {
+      mkdir((root + "/" + id).c_str(), 0755);
+    }
+    writeFile(root + "/28-000000000001/temperature", "23125\n");
+    writeFile(root + "/28-000000000002/temperature", "-10062\n");
+    writeFile(root + "/28-000000000003/w1_slave", "72 01 4b 46 7f ff 0e 10 57 : crc=57 YES\n72 01 4b 46 7f ff 0e 10 57 t=23125\n");
+    writeFile(root + "/28-000000000004/w1_slave", "72 01 4b 46 7f ff 0e 10 57 : crc=58 NO\n72 01 4b 46 7f ff 0e 10 57 t=23125\n");
+
+    OneWireBus bus(root, 60000);
+    for ( const char* id : probeIds ) {
+      bus.add(id, root + "/" + id);
+    }
+    bus.add("28-missing", root + "/28-missing");
+
+    check("temperature", bus.getTemperature("28-000000000001"), 23.125);
+    check("negative temperature", bus.getTemperature("28-000000000002"), -10.062);
+    check("w1_slave fallback", bus.getTemperature("28-000000000003"), 23.125);
+    check("w1_slave crc failure", bus.getTemperature("28-000000000004"), NAN);
+    check("missing probe", bus.getTemperature("28-missing"), NAN);
+    check("unknown id", bus.getTemperature("28-unknown"), NAN);
+    if ( readFile(root + "/w1_bus_master1/therm_bulk_read") != "trigger" ) {
+      cout << "FAILED: OneWireBus bulk conversion not triggered" << endl;
+    }
+
+    // cached until refreshed
+    writeFile(root + "/28-000000000001/temperature", "24000\n");
+    check("cached", bus.getTemperature("28-000000000001"), 23.125);
+    bus.refresh();
+    check("refreshed", bus.getTemperature("28-000000000001"), 24.0);
+
+    float celcius;
+    if ( OneWireBus::parseTemperature("12x34\n", celcius) || OneWireBus::parseTemperature("", celcius) ) {
+      cout << "FAILED: OneWireBus parsed invalid temperature" << endl;
+    }
+
+    system(("rm -rf " + root).c_str());
+    cout << "OneWireBus tests complete" << endl;
+  }
+};
@@ -0,0 +1,216 @@
+
+#include "automation/Automation.h"
+#include "xmonit/OpenHabClient.h"
+#include "xmonit/OpenHabEventStream.h"
+
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/StreamCopier.h>
+
+#include <atomic>
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace xmonit;
+
+
+struct OpenHabClientTests {
+
+  // stub of the OpenHAB REST api on a local port
+  struct StubState {
+    std::atomic<int> requestCnt {0};
+    std::atomic<int> eventStreamCnt {0};
+    std::atomic<int> itemsDelayMs {0};
+    std::atomic<bool> bItemsFailing {false};
+    string lastUri, lastBody, eventsUri;
+    string hvacState = "ON"; // as returned by the bulk fetch
+  };
+
+  static StubState& stub() {
+    static StubState state;
+    return state;
+  }
+
+  struct ItemsHandler : public Poco::Net::HTTPRequestHandler {
+    void handleRequest(Poco::Net::HTTPServerRequest& req, Poco::Net::HTTPServerResponse& resp) override {
+      if ( req.getURI().find("/rest/events") == 0 ) {
+        // one event then close so the stream has to reconnect
+        stub().eventStreamCnt++;
+        stub().eventsUri = req.getURI();
+        resp.setContentType("text/event-stream");
+        resp.setKeepAlive(false);
+        resp.send() << "event: message\n"
+                       "data: {\"topic\":\"smarthome/items/Hvac_Switch/statechanged\",\"payload\":\"{\\\"type\\\":\\\"OnOff\\\",\\\"value\\\":\\\"OFF\\\",\\\"oldType\\\":\\\"OnOff\\\",\\\"oldValue\\\":\\\"ON\\\"}\",\"type\":\"ItemStateChangedEvent\"}\n"
+                       "\n" << std::flush;
+        return;
+      }
+      stub().requestCnt++;
+      stub().lastUri = req.getURI();
+      if ( req.getMethod() == Poco::Net::HTTPRequest::HTTP_POST ) {
+        stub().lastBody.clear();
+        Poco::StreamCopier::copyToString(req.stream(), stub().lastBody);
+        resp.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        resp.send();
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(stub().itemsDelayMs));
+      if ( stub().bItemsFailing ) {
+        resp.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+        resp.send();
+        return;
+      }
+      resp.setContentType("application/json");
+      resp.send() << "[{\"name\":\"Hvac_Switch\",\"state\":\"" << stub().hvacState << "\",\"tags\":[\"solar\",\"ON\"]},"
+                     "{\"name\":\"Lights_Switch\",\"state\":\"OFF\",\"editable\":true,\"order\":3},"
+                     "{\"name\":\"Untracked_Switch\",\"state\":\"ON\"},"
+                     "{\"name\":\"Dimmer\",\"state\":\"NULL\"}]";
+    }
+  };
+
+  struct ItemsHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+    Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& req) override {
+      return new ItemsHandler;
+    }
+  };
+
+  struct Listener : public OpenHabClient::ItemListener {
+    string itemName;
+    float state = NAN;
+    void itemStateChanged(const string& changedItemName, float changedState) override {
+      itemName = changedItemName;
+      state = changedState;
+    }
+  };
+
+  static void check(const string& name, float actual, float expected) {
+    if ( isnan(expected) ? !isnan(actual) : actual != expected ) {
+      cout << "FAILED: OpenHabClient " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    Poco::Net::ServerSocket socket(0);
+    Poco::Net::HTTPServer server(new ItemsHandlerFactory, socket, new Poco::Net::HTTPServerParams);
+    server.start();
+
+    OpenHabClient client("127.0.0.1", socket.address().port(), "solar", 60000);
+    client.track("Hvac_Switch");
+    client.track("Lights_Switch");
+    client.track("Dimmer");
+    client.track("Missing_Switch");
+
+    check("ON state", client.getState("Hvac_Switch"), 1);
+    check("OFF state", client.getState("Lights_Switch"), 0);
+    check("NULL state", client.getState("Dimmer"), NAN);
+    check("missing item", client.getState("Missing_Switch"), NAN);
+    check("untracked item", client.getState("Untracked_Switch"), NAN);
+    if ( stub().requestCnt != 1 ) {
+      cout << "FAILED: OpenHabClient expected one bulk request but there were " << stub().requestCnt << endl;
+    }
+    if ( stub().lastUri != "/rest/items?fields=name,state&tags=solar" ) {
+      cout << "FAILED: OpenHabClient unexpected bulk request uri " << stub().lastUri << endl;
+    }
+
+    Poco::JSON::Object::Ptr pResp = client.processRequest(Poco::Net::HTTPRequest::HTTP_POST, "/rest/items/Lights_Switch", "ON", "text/plain");
+    if ( pResp->getValue<int>("status") != 200 || stub().lastBody != "ON" || stub().lastUri != "/rest/items/Lights_Switch" ) {
+      cout << "FAILED: OpenHabClient command not sent" << endl;
+    }
+
+    if ( !client.fetchStates() || stub().requestCnt != 3 ) {
+      cout << "FAILED: OpenHabClient fetchStates did not fetch" << endl;
+    }
+    check("unchanged states not queued", client.dispatchEvents(), 0);
+
+    // changes found by a fetch reach listeners like pushed ones
+    Listener listener;
+    client.track("Hvac_Switch", &listener);
+    stub().hvacState = "OFF";
+    client.fetchStates();
+    check("fetched change queued", client.dispatchEvents(), 1);
+    check("fetched change state", listener.state, 0);
+
+    // pushes and commands do not wait for a slow fetch and a push is not undone by it
+    stub().itemsDelayMs = 500;
+    std::thread fetcher([&client]() { client.fetchStates(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto startTime = std::chrono::steady_clock::now();
+    client.pushState("Hvac_Switch", "ON");
+    client.processRequest(Poco::Net::HTTPRequest::HTTP_POST, "/rest/items/Lights_Switch", "OFF", "text/plain");
+    long waitedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    fetcher.join();
+    if ( waitedMs > 300 ) {
+      cout << "FAILED: OpenHabClient push and command waited " << waitedMs << "ms for fetch" << endl;
+    }
+    check("push during fetch kept", client.getState("Hvac_Switch"), 1);
+    check("only push dispatched", client.dispatchEvents(), 1);
+    check("push during fetch dispatched", listener.state, 1);
+    stub().itemsDelayMs = 0;
+
+    // a failed fetch is retried even while pushed events are expected
+    OpenHabClient pushedClient("127.0.0.1", socket.address().port(), "", 10);
+    pushedClient.track("Hvac_Switch");
+    pushedClient.setPushConnected(true);
+    stub().bItemsFailing = true;
+    check("push connected fetch failed", pushedClient.fetchStates(), false);
+    check("state after failed fetch", pushedClient.getState("Hvac_Switch"), NAN);
+    stub().bItemsFailing = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    check("fetched again after failure", pushedClient.getState("Hvac_Switch"), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int requestCnt = stub().requestCnt;
+    pushedClient.getState("Hvac_Switch");
+    check("pushed states not polled", stub().requestCnt, requestCnt);
+
+    // event stream
+    OpenHabEventStream events(client, "127.0.0.1", socket.address().port());
+    events.minBackoffMs = 20;
+    events.maxBackoffMs = 50;
+    events.start();
+    if ( !client.waitForEvents(5000) ) {
+      cout << "FAILED: OpenHabEventStream no event pushed" << endl;
+    }
+    if ( client.dispatchEvents() < 1 || listener.itemName != "Hvac_Switch" ) {
+      cout << "FAILED: OpenHabEventStream listener not called" << endl;
+    }
+    check("pushed state", listener.state, 0);
+    if ( stub().eventsUri.find("smarthome/items/Hvac_Switch/statechanged") == string::npos ) {
+      cout << "FAILED: OpenHabEventStream unexpected events uri " << stub().eventsUri << endl;
+    }
+    for ( int i = 0; i < 100 && events.getConnectCount() < 3; i++ ) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if ( events.getConnectCount() < 3 ) {
+      cout << "FAILED: OpenHabEventStream did not reconnect (" << events.getConnectCount() << " connects)" << endl;
+    }
+    events.stop();
+    if ( client.isPushConnected() ) {
+      cout << "FAILED: OpenHabEventStream still push connected after stop" << endl;
+    }
+
+    string itemName, state;
+    if ( !OpenHabEventStream::parseEvent("{\"topic\":\"openhab/items/Fan/statechanged\",\"payload\":\"{\\\"type\\\":\\\"OnOff\\\",\\\"value\\\":\\\"ON\\\"}\"}",
+                                         "openhab/items", itemName, state) || itemName != "Fan" || state != "ON" ) {
+      cout << "FAILED: OpenHabEventStream parseEvent statechanged" << endl;
+    }
+    if ( OpenHabEventStream::parseEvent("{\"topic\":\"openhab/items/Fan/command\",\"payload\":\"{\\\"value\\\":\\\"ON\\\"}\"}", "openhab/items", itemName, state) ) {
+      cout << "FAILED: OpenHabEventStream parseEvent accepted command event" << endl;
+    }
+    if ( OpenHabEventStream::parseEvent("{\"topic\":\"smarthome/items/Fan/statechanged\",\"payload\":\"{}\"}", "openhab/items", itemName, state) ) {
+      cout << "FAILED: OpenHabEventStream parseEvent accepted other topic prefix" << endl;
+    }
+
+    server.stop();
+    cout << "OpenHabClient tests complete" << endl;
+  }
+};
@@ -0,0 +1,75 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/Sensor.h"
+#include "automation/device/PowerBudget.h"
+#include "automation/constraint/ValueConstraint.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace automation;
+
+
+struct PowerBudgetTests {
+
+  struct TestSwitch : public automation::PowerSwitch {
+    bool bOn {false};
+    RTTI_GET_TYPE_IMPL(automation::test,TestSwitch)
+    TestSwitch(const string& name, float requiredWatts) : PowerSwitch(name,requiredWatts) {}
+    bool isOn() const override { return bOn; }
+    void setOn(bool bOn) override { this->bOn = bOn; }
+    void setup() override {}
+  };
+
+  static float& inputPower() {
+    static float inputPower = 100;
+    return inputPower;
+  }
+
+  static void check(const string& name, float actual, float expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: PowerBudget " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    static SensorFn power("input power", [](){ return inputPower(); });
+    power.setCacheable(false);
+    TestSwitch hvac("hvac", 500), lights("lights", 300);
+    PowerBudget budget;
+    budget.add(&hvac);
+    budget.add(&lights);
+
+    AtLeast<float,Sensor> haveRequiredPower(450, power);
+    haveRequiredPower.setPassDelayMs(30*SECONDS);
+    PowerReservationHandler reservation(budget, &hvac);
+    haveRequiredPower.listeners.add(&reservation);
+
+    haveRequiredPower.test();
+    check("nothing reserved", budget.getReservedWatts(), 0);
+    inputPower() = 900;
+    haveRequiredPower.test();
+    check("deferred pass", haveRequiredPower.isDeferred(), true);
+    check("deferred pass reserves", budget.getReservedWatts(), 500);
+    check("others see reservation", budget.getRequiredWatts(&lights), 800);
+    check("own reservation not counted twice", budget.getRequiredWatts(&hvac), 500);
+
+    inputPower() = 100;
+    haveRequiredPower.test();
+    check("cancelled", haveRequiredPower.isDeferred(), false);
+    check("cancelled deferral releases", budget.getReservedWatts(), 0);
+
+    inputPower() = 900;
+    haveRequiredPower.test();
+    check("reserved again", budget.getReservedWatts(), 500);
+    hvac.toggle.setValue(true);
+    hvac.flush();
+    check("committed when on", budget.getCommittedWatts(), 500);
+    check("released when on", budget.getReservedWatts(), 0);
+
+    cout << "PowerBudget tests complete" << endl;
+  }
+};
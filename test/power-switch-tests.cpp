@@ -0,0 +1,143 @@
+
+#include "automation/Automation.h"
+#include "automation/device/PowerSwitch.h"
+#include "automation/constraint/BooleanConstraint.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace automation;
+
+
+struct PowerSwitchTests {
+
+  // counts writes and echoes them to the constraint like the openhab and gpio switches
+  struct TestSwitch : public automation::PowerSwitch {
+    bool bOn {false};
+    bool bFailing {false};
+    int writeCnt {0};
+    mutable int readCnt {0};
+    RTTI_GET_TYPE_IMPL(automation::test,TestSwitch)
+    TestSwitch(const string& name) : PowerSwitch(name) {}
+    bool isOn() const override { readCnt++; return bOn; }
+    void setOn(bool bOn) override {
+      writeCnt++;
+      bError = bFailing;
+      if ( !bError ) {
+        this->bOn = bOn;
+        if ( getConstraint() ) {
+          getConstraint()->overrideTestResult(bOn);
+        }
+      }
+    }
+    void setup() override {}
+
+    // switched on the device itself (or by openhab)
+    void changedRemotely(bool bOn) {
+      this->bOn = bOn;
+      acknowledge(bOn);
+    }
+  };
+
+  struct SentListener : public Capability::CapabilityListener {
+    int sentCnt {0};
+    float lastVal {-1};
+    void valueSet(const Capability* pCapability, float newVal, float oldVal) override { sentCnt++; lastVal = newVal; }
+  };
+
+  static void check(const string& name, int actual, int expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: PowerSwitch " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    TestSwitch sw("fan");
+    sw.toggle.setValue(true);
+    sw.toggle.setValue(false);
+    check("off sent immediately", sw.writeCnt, 1);
+    sw.toggle.setValue(true);
+    sw.toggle.setValue(true);
+    check("on waits for flush", sw.writeCnt, 1);
+    check("flush sends on", sw.flush(), true);
+    check("on sent once", sw.writeCnt, 2);
+    check("nothing pending", sw.isCommandPending(), false);
+    sw.changedRemotely(true); // read back
+    sw.toggle.setValue(true);
+    check("same state not sent", sw.flush(), false);
+    check("same state write count", sw.writeCnt, 2);
+
+    sw.bFailing = true;
+    sw.toggle.setValue(false);
+    check("failed command pending", sw.isCommandPending(), true);
+    check("failed off pending", sw.isOffPending(), true);
+    check("failed write count", sw.writeCnt, 3);
+    sw.bFailing = false;
+    sw.flush();
+    check("retried command", sw.writeCnt, 4);
+    check("retried state", sw.bOn, false);
+
+    sw.changedRemotely(true);
+    sw.toggle.setValue(true);
+    check("remote state acknowledged", sw.flush(), false);
+    sw.toggle.setValue(false);
+    check("off after remote change", sw.writeCnt, 5);
+
+    TestSwitch unobservedSw("heater"); // never acknowledges like the ifttt switches
+    unobservedSw.toggle.setValue(true);
+    unobservedSw.flush();
+    unobservedSw.refreshObservedState();
+    unobservedSw.toggle.setValue(true); // may have been switched off outside the app
+    check("resent without read back", unobservedSw.flush(), true);
+    check("resent write count", unobservedSw.writeCnt, 2);
+
+    // budgets and start spacing only count commands that were sent
+    TestSwitch listenedSw("compressor");
+    SentListener listener;
+    listenedSw.toggle.addListener(&listener);
+    listenedSw.toggle.setValue(true);
+    check("not notified before flush", listener.sentCnt, 0);
+    listenedSw.bFailing = true;
+    listenedSw.flush();
+    check("not notified when failed", listener.sentCnt, 0);
+    listenedSw.bFailing = false;
+    listenedSw.flush();
+    check("notified when sent", listener.sentCnt, 1);
+    check("notified value", listener.lastVal, 1);
+    listenedSw.changedRemotely(true);
+    listenedSw.toggle.setValue(true);
+    listenedSw.flush();
+    check("not notified when coalesced", listener.sentCnt, 1);
+    listenedSw.toggle.setValue(false);
+    check("off notified", listener.sentCnt, 2);
+
+    TestSwitch remoteSw("pump");
+    BooleanConstraint constraint(false);
+    constraint.mode = Constraint::REMOTE_MODE;
+    remoteSw.setConstraint(&constraint);
+    remoteSw.setAttribute("on", "true");
+    remoteSw.flush();
+    check("remote on sent once", remoteSw.writeCnt, 1);
+    check("remote on state", remoteSw.bOn, true);
+    check("constraint follows switch", constraint.isPassed(), true);
+
+    TestSwitch observedSw("light");
+    observedSw.bOn = true;
+    check("first read refreshes", observedSw.toggle.getValue(), 1);
+    observedSw.toggle.getValue();
+    check("observed reads are local", observedSw.readCnt, 1);
+    observedSw.bOn = false; // changed on the device
+    check("observed until refresh", observedSw.toggle.getValue(), 1);
+    observedSw.refreshObservedState();
+    check("refreshed", observedSw.toggle.getValue(), 0);
+    observedSw.toggle.setValue(true);
+    observedSw.flush();
+    check("command updates observed", observedSw.isOnObserved(), true);
+    check("reads after command", observedSw.readCnt, 2);
+
+    cout << "PowerSwitch tests complete" << endl;
+  }
+};
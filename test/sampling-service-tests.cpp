@@ -0,0 +1,79 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/Sensor.h"
+#include "automation/sensor/SamplingService.h"
+
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace automation;
+
+
+struct SamplingServiceTests {
+
+  // returns the next reading each call and stays at the last one
+  struct SequenceSensor : public Sensor {
+    RTTI_GET_TYPE_IMPL(automation::test,SequenceSensor)
+    vector<float> readings;
+    mutable size_t readCnt {0};
+    SequenceSensor(const vector<float>& readings) : Sensor("sequence", 3, 10), readings(readings) {}
+    float getValueImpl() const override {
+      float val = readings[std::min(readCnt, readings.size()-1)];
+      readCnt++;
+      return val;
+    }
+  };
+
+  struct RecordingListener : public SensorListener {
+    mutable vector<float> values;
+    void changed(const Sensor* pSensor, float newVal, float oldVal) const override {
+      values.push_back(newVal);
+    }
+  };
+
+  static void check(const string& name, float actual, float expected) {
+    if ( actual != expected && !(isnan(actual) && isnan(expected)) ) {
+      cout << "FAILED: SamplingService " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    std::mutex appMutex;
+    SequenceSensor sensor({1, 2, 3, NAN, 4, 5, 6, 7});
+    RecordingListener listener;
+    SamplingService<std::mutex> sampler(appMutex);
+    sampler.add(&sensor);
+    sensor.addListener(&listener);
+    check("async sampled", sensor.isAsyncSampled(), true);
+    check("no value before first average", sensor.getValue(), NAN);
+
+    sampler.start();
+    for ( int i = 0; i < 200; i++ ) {
+      {
+        std::lock_guard<std::mutex> lock(appMutex);
+        if ( listener.values.size() >= 3 ) {
+          break;
+        }
+      }
+      automation::sleep(10);
+    }
+    sampler.stop();
+
+    std::lock_guard<std::mutex> lock(appMutex);
+    check("published", listener.values.size() >= 3, true);
+    if ( listener.values.size() >= 3 ) {
+      check("first average", listener.values[0], 2);
+      check("failed read published", listener.values[1], NAN);
+      check("average after failure", listener.values[2], 5);
+      size_t readCnt = sensor.readCnt;
+      check("getValue does not read", sensor.getValue(), listener.values.back());
+      check("read count unchanged", sensor.readCnt, readCnt);
+    }
+    cout << "SamplingService tests complete" << endl;
+  }
+};
@@ -0,0 +1,99 @@
+
+#include "automation/Automation.h"
+#include "automation/constraint/ScheduledConstraint.h"
+
+#include <ctime>
+#include <iostream>
+
+using namespace std;
+using namespace automation;
+
+
+struct ScheduledConstraintTests {
+
+  // local time (mktime handles DST)
+  static time_t toTime(int year, int month, int day, int hour, int minute, int second) {
+    struct tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon = month - 1;
+    t.tm_mday = day;
+    t.tm_hour = hour;
+    t.tm_min = minute;
+    t.tm_sec = second;
+    t.tm_isdst = -1;
+    return mktime(&t);
+  }
+
+  static const vector<pair<uint16_t,uint16_t>>& noRanges() {
+    static vector<pair<uint16_t,uint16_t>> noRanges;
+    return noRanges;
+  }
+
+  static void check(const string& name, long actual, long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: ScheduledConstraint " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void runMaskTests() {
+
+    ScheduledConstraint::UnitMask<0,59> mask;
+    check("default allows all", mask.check(42), true);
+    mask = {{10,20},{30,30}};
+    check("below range", mask.check(9), false);
+    check("range start", mask.check(10), true);
+    check("range end", mask.check(20), true);
+    check("between ranges", mask.check(25), false);
+    check("single value", mask.check(30), true);
+    check("out of bounds", mask.check(60), false);
+    check("not all", mask.bAll, false);
+    check("next in range", mask.next(0), 10);
+    check("next single", mask.next(21), 30);
+    check("next none", mask.next(31), -1);
+    mask = noRanges();
+    check("empty allows all", mask.check(5), true);
+    check("empty is all", mask.bAll, true);
+    mask = {{0,29},{30,59}};
+    check("full ranges are all", mask.bAll, true);
+
+    ScheduledConstraint::UnitMask<1,31> monthDays;
+    monthDays = {{1,31}};
+    check("one based full", monthDays.bAll, true);
+  }
+
+  static void runTransitionTests() {
+
+    ScheduledConstraint workHours;
+    workHours.seconds = noRanges();
+    workHours.minutes = noRanges();
+    workHours.hours = {{9,17}};
+    workHours.weekDays = {{1,5}}; // monday-friday
+
+    time_t monday = toTime(2026,6,15,8,30,0);
+    check("empty fields match", workHours.checkRanges(LocalTime::get(toTime(2026,6,15,10,15,30))), true);
+    check("before start", workHours.checkRanges(LocalTime::get(monday)), false);
+    check("next start", workHours.nextTransition(monday), toTime(2026,6,15,9,0,0));
+    check("next end", workHours.nextTransition(toTime(2026,6,15,10,0,0)), toTime(2026,6,15,18,0,0));
+    check("friday evening to monday", workHours.nextTransition(toTime(2026,6,19,18,0,0)), toTime(2026,6,22,9,0,0));
+
+    ScheduledConstraint firstOfMonth;
+    firstOfMonth.monthDays = {{1,1}};
+    check("month day start", firstOfMonth.nextTransition(toTime(2026,6,15,12,0,0)), toTime(2026,7,1,0,0,0));
+    check("month day end", firstOfMonth.nextTransition(toTime(2026,7,1,12,0,0)), toTime(2026,7,2,0,0,0));
+
+    ScheduledConstraint always;
+    check("unrestricted never changes", always.nextTransition(monday), 0);
+
+    ScheduledConstraint past;
+    past.years = {{100,100}}; // 2000
+    check("no future match", past.nextTransition(monday), 0);
+  }
+
+public:
+
+  static void run() {
+    runMaskTests();
+    runTransitionTests();
+    cout << "ScheduledConstraint tests complete" << endl;
+  }
+};
@@ -0,0 +1,67 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/SensorHistory.h"
+
+#include <deque>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+using namespace automation;
+
+
+struct SensorHistoryTests {
+
+  static void check(const string& name, int i, float actual, float expected) {
+    if ( fabs(actual - expected) > 0.001 * max(1.0f, fabs(expected)) ) {
+      cout << "FAILED: SensorHistory " << name << " at " << i << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    // compare against recomputing over the window
+    const uint16_t capacity = 16;
+    const unsigned long maxAgeMs = 20000;
+    SensorHistory history(capacity, maxAgeMs);
+    deque<pair<unsigned long,float>> window;
+    unsigned long timeMs = 4000000000UL; // rebase and wrap around of 32 bit millis
+    srand(1);
+    for ( int i = 0; i < 5000; i++ ) {
+      timeMs += 500 + rand() % 2000;
+      float val = (rand() % 10000) / 100.0 - 50;
+      history.add(val, timeMs);
+      window.push_back({timeMs, val});
+      while ( window.size() > capacity || timeMs - window.front().first > maxAgeMs ) {
+        window.pop_front();
+      }
+      float sum = 0, minVal = INFINITY, maxVal = -INFINITY;
+      for ( auto& s : window ) {
+        sum += s.second;
+        minVal = min(minVal, s.second);
+        maxVal = max(maxVal, s.second);
+      }
+      if ( history.size() != window.size() ) {
+        cout << "FAILED: SensorHistory size at " << i << " expected " << window.size() << " but was " << history.size() << endl;
+      }
+      check("mean", i, history.mean(), sum / window.size());
+      check("minimum", i, history.minimum(), minVal);
+      check("maximum", i, history.maximum(), maxVal);
+    }
+
+    // 2 units per second
+    SensorHistory line(8);
+    for ( int i = 0; i < 20; i++ ) {
+      line.add(10 + 2*i, 1000*i);
+    }
+    check("slope", 0, line.slope(), 2.0);
+    line.expire(1000*40);
+    check("slope without age limit", 0, line.slope(), 2.0);
+
+    cout << "SensorHistory tests complete" << endl;
+  }
+};
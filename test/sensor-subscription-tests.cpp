@@ -0,0 +1,82 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/Sensor.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace automation;
+
+
+struct SensorSubscriptionTests {
+
+  struct TestSensor : public Sensor {
+    RTTI_GET_TYPE_IMPL(automation::test,TestSensor)
+    TestSensor() : Sensor("test") {}
+    float getValueImpl() const override { return 0; }
+  };
+
+  struct RecordingListener : public SensorListener {
+    mutable vector<pair<float,float>> changes; // new and old values
+    void changed(const Sensor* pSensor, float newVal, float oldVal) const override {
+      changes.push_back({newVal, oldVal});
+    }
+  };
+
+  static void check(const string& name, float actual, float expected) {
+    if ( actual != expected && !(isnan(actual) && isnan(expected)) ) {
+      cout << "FAILED: SensorSubscription " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void runIsChangeTests() {
+    SensorSubscription sub{nullptr, 0.5, 1000, NAN, 0, false};
+    check("first value", sub.isChange(10, 0), true);
+    sub.lastValue = 10;
+    sub.bNotified = true;
+    check("same value", sub.isChange(10, 5000), false);
+    check("within deadband", sub.isChange(10.3, 5000), false);
+    check("within deadband below", sub.isChange(9.6, 5000), false);
+    check("too soon", sub.isChange(10.6, 999), false);
+    check("outside deadband", sub.isChange(10.6, 1000), true);
+    check("failed read", sub.isChange(NAN, 1000), true);
+    sub.lastValue = NAN;
+    check("still failing", sub.isChange(NAN, 5000), false);
+    check("recovered", sub.isChange(10, 5000), true);
+  }
+
+  static void runListenerTests() {
+    TestSensor sensor;
+    RecordingListener everyChange, deadband, throttled;
+    sensor.addListener(&everyChange);
+    sensor.addListener(&deadband, 0.5);
+    sensor.addListener(&throttled, 0, 60*MINUTES);
+
+    for ( float val : {10.0f, 10.0f, 10.3f, 10.6f, 9.0f} ) {
+      sensor.publishSample(val);
+    }
+    check("every change", everyChange.changes.size(), 4);
+    check("deadband changes", deadband.changes.size(), 3);
+    if ( deadband.changes.size() == 3 ) {
+      check("deadband new", deadband.changes[1].first, 10.6f);
+      check("deadband old is last notified", deadband.changes[1].second, 10);
+      check("first old value", deadband.changes[0].second, NAN);
+    }
+    check("throttled", throttled.changes.size(), 1);
+
+    sensor.removeListener(&everyChange);
+    sensor.publishSample(20);
+    check("removed listener", everyChange.changes.size(), 4);
+    check("remaining listener", deadband.changes.size(), 4);
+    check("cached value", sensor.getValue(), 20);
+  }
+
+public:
+
+  static void run() {
+    runIsChangeTests();
+    runListenerTests();
+    cout << "SensorSubscription tests complete" << endl;
+  }
+};
@@ -1,6 +1,26 @@
 
 #include "automation/Automation.h"
 #include "constraint-tests.cpp"
+#include "allocator-tests.cpp"
+#include "onewire-tests.cpp"
+#include "sensor-history-tests.cpp"
+#include "openhab-tests.cpp"
+#include "gpio-tests.cpp"
+#include "http-client-pool-tests.cpp"
+#include "dns-cache-tests.cpp"
+#include "circuit-breaker-tests.cpp"
+#include "power-switch-tests.cpp"
+#include "webhook-dispatcher-tests.cpp"
+#include "actuator-metrics-tests.cpp"
+#include "what-if-tests.cpp"
+#include "value-constraint-tests.cpp"
+#include "scheduled-constraint-tests.cpp"
+#include "time-range-tests.cpp"
+#include "power-budget-tests.cpp"
+#include "sensor-subscription-tests.cpp"
+#include "sampling-service-tests.cpp"
+#include "cacheable-tests.cpp"
+#include "filter-sensor-tests.cpp"
 
 #include <Poco/Util/Application.h>
 #include <Poco/DateTimeFormatter.h>
@@ -44,6 +64,26 @@ public:
     cout << "START TIME: " << DateTimeFormatter::format(LocalDateTime(), DateTimeFormat::SORTABLE_FORMAT) << endl;
 
     ConstraintTests::run();
+    PowerAllocatorTests::run();
+    OneWireBusTests::run();
+    SensorHistoryTests::run();
+    OpenHabClientTests::run();
+    GpioTests::run();
+    HttpClientPoolTests::run();
+    DnsCacheTests::run();
+    CircuitBreakerTests::run();
+    PowerSwitchTests::run();
+    WebHookDispatcherTests::run();
+    ActuatorMetricsTests::run();
+    WhatIfTests::run();
+    ValueConstraintTests::run();
+    ScheduledConstraintTests::run();
+    TimeRangeTests::run();
+    PowerBudgetTests::run();
+    SensorSubscriptionTests::run();
+    SamplingServiceTests::run();
+    CacheableTests::run();
+    FilterSensorTests::run();
 
     cout << "END TIME: " << DateTimeFormatter::format(LocalDateTime(), DateTimeFormat::SORTABLE_FORMAT) << endl;
     return 0;
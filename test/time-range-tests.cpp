@@ -0,0 +1,89 @@
+
+#include "automation/Automation.h"
+#include "automation/constraint/TimeRangeConstraint.h"
+#include "automation/constraint/LocalTime.h"
+
+#include <atomic>
+#include <ctime>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace automation;
+
+
+struct TimeRangeTests {
+
+  // local time (mktime handles DST)
+  static time_t toTime(int hour, int minute, int second, int day = 15) {
+    struct tm t = {};
+    t.tm_year = 2026 - 1900;
+    t.tm_mon = 5;
+    t.tm_mday = day;
+    t.tm_hour = hour;
+    t.tm_min = minute;
+    t.tm_sec = second;
+    t.tm_isdst = -1;
+    return mktime(&t);
+  }
+
+  static void check(const string& name, long actual, long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: TimeRange " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void runBoundaryTests() {
+
+    TimeRangeConstraint daytime({9,30,0},{18,0,0});
+    check("in range", daytime.isInRange(toTime(12,0,0)), true);
+    check("end inclusive", daytime.isInRange(toTime(18,0,0)), true);
+    check("after end", daytime.isInRange(toTime(18,0,1)), false);
+    check("next end", daytime.nextBoundary(toTime(12,0,0)), toTime(18,0,1));
+    check("next begin", daytime.nextBoundary(toTime(8,0,0)), toTime(9,30,0));
+    check("begin tomorrow", daytime.nextBoundary(toTime(19,0,0)), toTime(9,30,0,16));
+
+    TimeRangeConstraint overnight({22,0,0},{6,0,0});
+    check("wrapped before midnight", overnight.isInRange(toTime(23,0,0)), true);
+    check("wrapped after midnight", overnight.isInRange(toTime(5,0,0)), true);
+    check("wrapped outside", overnight.isInRange(toTime(12,0,0)), false);
+    check("wrapped end tomorrow", overnight.nextBoundary(toTime(23,0,0)), toTime(6,0,1,16));
+    check("wrapped end today", overnight.nextBoundary(toTime(1,0,0)), toTime(6,0,1));
+    check("wrapped begin", overnight.nextBoundary(toTime(12,0,0)), toTime(22,0,0));
+
+    TimeRangeConstraint allDay({0,0,0},{23,59,59});
+    check("whole day", allDay.nextBoundary(toTime(12,0,0)), 0);
+    TimeRangeConstraint wrappedAllDay({12,0,0},{11,59,59});
+    check("wrapped whole day", wrappedAllDay.nextBoundary(toTime(12,0,0)), 0);
+    check("wrapped whole day in range", wrappedAllDay.isInRange(toTime(11,59,59)), true);
+    TimeRangeConstraint almostAllDay({12,0,0},{11,59,58});
+    check("one second gap", almostAllDay.nextBoundary(toTime(11,0,0)), toTime(11,59,59));
+    TimeRangeConstraint toMidnight({18,0,0},{23,59,59});
+    check("end at midnight", toMidnight.nextBoundary(toTime(20,0,0)), toTime(0,0,0,16));
+  }
+
+  // each thread sees the time it asked for even while others use the cache
+  static void runThreadTests() {
+    std::atomic<int> mismatchCnt {0};
+    auto readHour = [&](int hour) {
+      time_t t = toTime(hour,0,0);
+      for ( int i = 0; i < 20000; i++ ) {
+        if ( LocalTime::get(t + i%2).tm_hour != hour ) {
+          mismatchCnt++;
+        }
+      }
+    };
+    std::thread morning(readHour, 8), evening(readHour, 20);
+    morning.join();
+    evening.join();
+    check("cache per thread", mismatchCnt, 0);
+  }
+
+public:
+
+  static void run() {
+    runBoundaryTests();
+    runThreadTests();
+    cout << "TimeRange tests complete" << endl;
+  }
+};
@@ -0,0 +1,144 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/Sensor.h"
+#include "automation/constraint/ValueConstraint.h"
+#include "automation/constraint/StaticValueConstraint.h"
+#include "automation/constraint/ComparisonCache.h"
+#include "automation/constraint/EvaluationContext.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace automation;
+
+
+struct ValueConstraintTests {
+
+  static float& batteryVoltage() {
+    static float batteryVoltage = 26;
+    return batteryVoltage;
+  }
+
+  static int& readCnt() {
+    static int readCnt = 0;
+    return readCnt;
+  }
+
+  static void check(const string& name, long actual, long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: ValueConstraint " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+  static void runComparisonCacheTests() {
+
+    static SensorFn voltage("voltage", [](){ readCnt()++; return batteryVoltage(); });
+    voltage.setCacheable(false);
+    AtLeast<float,Sensor> fanVoltage(25, voltage), pumpVoltage(25, voltage), heaterVoltage(25.5, voltage);
+    ComparisonCache& cache = ComparisonCache::instance;
+
+    cache.beginTick();
+    unsigned long startHits = cache.hits;
+    fanVoltage.test();
+    pumpVoltage.test();
+    heaterVoltage.test();
+    check("one read per tick", readCnt(), 1);
+    check("same bounds shared", cache.hits - startHits, 1);
+    batteryVoltage() = 24;
+    check("cached within tick", fanVoltage.test(), true);
+    cache.suspend();
+    check("live read while suspended", fanVoltage.test(), false);
+    check("suspended read count", readCnt(), 2);
+    {
+      ComparisonCache::ResumedScope scope(cache);
+      check("cached after resume", pumpVoltage.test(), true);
+    }
+    check("suspended after scope", cache.isActive(), false);
+    batteryVoltage() = 26;
+    cache.endTick();
+
+    batteryVoltage() = 24;
+    cache.beginTick();
+    check("recomputed next tick", fanVoltage.test(), false);
+    check("shared new result", pumpVoltage.test(), false);
+    check("read again", readCnt(), 3);
+    cache.endTick();
+
+    check("live read outside tick", heaterVoltage.test(), false);
+    check("not cached outside tick", readCnt(), 4);
+    batteryVoltage() = 26;
+  }
+
+  static void runIntegralTests() {
+
+    static SensorFn level("level", [](){ return -100.0f; });
+    level.setCacheable(false);
+    AtMost<int,Sensor> atMost(5, level);
+    AtLeast<int,Sensor> atLeast(-200, level);
+    check("int AtMost open below", atMost.test(), true);
+    check("int AtLeast open above", atLeast.test(), true);
+    int minVal, maxVal;
+    atMost.getBounds(5, minVal, maxVal, false, false);
+    check("int lowest", minVal, std::numeric_limits<int>::lowest());
+    atLeast.getBounds(-200, minVal, maxVal, false, false);
+    check("int max", maxVal, std::numeric_limits<int>::max());
+  }
+
+  static int soc() {
+    return 80;
+  }
+
+  static void runStaticTests() {
+
+    static SensorFn voltage("voltage", [](){ return batteryVoltage(); });
+    voltage.setCacheable(false);
+    batteryVoltage() = 26;
+
+    SensorAtLeast<SensorFn> minVoltage{voltage, 25};
+    minVoltage.setPassMargin(1.5).setFailMargin(0.5);
+    check("sensor AtLeast", minVoltage.test(), true);
+    batteryVoltage() = 24.7;
+    check("fail margin holds", minVoltage.test(), true);
+    batteryVoltage() = 24.4;
+    check("below fail margin", minVoltage.test(), false);
+    batteryVoltage() = 26;
+    check("pass margin holds", minVoltage.test(), false);
+    batteryVoltage() = 26.6;
+    check("above pass margin", minVoltage.test(), true);
+
+    SensorAtMost<SensorFn> maxVoltage{voltage, 28};
+    check("sensor AtMost", maxVoltage.test(), true);
+    maxVoltage.setAttribute("threshold", "26");
+    check("AtMost threshold attribute", maxVoltage.test(), false);
+
+    SensorRange<SensorFn,NotNanValidator<float,true>> voltageRange{voltage, RangeComparator<float>(24, 27)};
+    check("sensor Range", voltageRange.test(), true);
+    batteryVoltage() = 27.5;
+    check("above Range", voltageRange.test(), false);
+    batteryVoltage() = NAN;
+    check("invalid passes", voltageRange.test(), true);
+    batteryVoltage() = 26;
+
+    StaticValueConstraint<int,FunctionSource<int,soc>,RangeComparator<int>> socRange{FunctionSource<int,soc>("soc"), RangeComparator<int>(50, 90)};
+    check("function Range", socRange.test(), true);
+    check("function title", socRange.getTitle() == "soc Range(50,90)", true);
+    StaticValueConstraint<int,FunctionSource<int,soc>,AtLeastComparator<int>> fullSoc{FunctionSource<int,soc>("soc"), AtLeastComparator<int>(95)};
+    check("function AtLeast", fullSoc.test(), false);
+    StaticValueConstraint<int,FunctionSource<int,soc>,AtMostComparator<int>> notFullSoc{FunctionSource<int,soc>("soc"), AtMostComparator<int>(95)};
+    check("function AtMost", notFullSoc.test(), true);
+
+    EvaluationContext ctx;
+    ctx.setValue(&voltage, 20);
+    check("evaluate overridden sensor", minVoltage.evaluate(ctx), false);
+    check("live unchanged", minVoltage.isPassed(), true);
+  }
+
+public:
+
+  static void run() {
+    runComparisonCacheTests();
+    runIntegralTests();
+    runStaticTests();
+    cout << "ValueConstraint tests complete" << endl;
+  }
+};
@@ -0,0 +1,88 @@
+
+#include "automation/Automation.h"
+#include "automation/sensor/Sensor.h"
+#include "automation/constraint/AndConstraint.h"
+#include "automation/constraint/ValueConstraint.h"
+#include "automation/constraint/EvaluationContext.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace automation;
+
+
+struct WhatIfTests {
+
+  // counts live notifications so evaluate() can be checked for side effects
+  struct CountingHandler : public ConstraintEventHandler {
+    mutable int cnt {0};
+    void resultDeferred(Constraint* pConstraint,bool bNext,unsigned long delayMs) const override { cnt++; }
+    void resultChanged(Constraint* pConstraint,bool bNew,unsigned long lastDurationMs) const override { cnt++; }
+    void deferralCancelled(Constraint* pConstraint,bool bCurrent,unsigned long lastDurationMs) const override { cnt++; }
+  };
+
+  static float& inputPower() {
+    static float inputPower = 500;
+    return inputPower;
+  }
+
+  static void check(const string& name, long actual, long expected) {
+    if ( actual != expected ) {
+      cout << "FAILED: WhatIf " << name << " expected " << expected << " but was " << actual << endl;
+    }
+  }
+
+public:
+
+  static void run() {
+
+    static SensorFn power("power", [](){ return inputPower(); });
+    power.setCacheable(false);
+    AtLeast<float,Sensor> enoughPower(450, power);
+    enoughPower.setPassDelayMs(30000);
+    AndConstraint haveRequiredPower({&enoughPower});
+    CountingHandler handler;
+    enoughPower.listeners.add(&handler);
+    haveRequiredPower.listeners.add(&handler);
+
+    haveRequiredPower.test();
+    check("live passed", haveRequiredPower.isPassed(), true);
+    handler.cnt = 0;
+
+    EvaluationContext ctx;
+    ctx.setValue(&power, 100);
+    check("low power fails", haveRequiredPower.evaluate(ctx), false);
+    check("live still passed", haveRequiredPower.isPassed(), true);
+    check("live child still passed", enoughPower.isPassed(), true);
+
+    EvaluationContext highCtx;
+    highCtx.setValue(&power, 100);
+    haveRequiredPower.evaluate(highCtx);
+    highCtx.setValue(&power, 900);
+    check("pass deferred", haveRequiredPower.evaluate(highCtx), false);
+    check("context deferred", highCtx.find(&enoughPower)->deferredResultCnt > 0, true);
+    highCtx.advance(31000);
+    check("pass after delay", haveRequiredPower.evaluate(highCtx), true);
+    check("live not deferred", enoughPower.isDeferred(), false);
+    check("no live events", handler.cnt, 0);
+
+    inputPower() = 100;
+    haveRequiredPower.test();
+    check("live fails on its own", haveRequiredPower.isPassed(), false);
+
+    EvaluationContext clockCtx(0);
+    time_t startTime = clockCtx.now;
+    for ( int i = 0; i < 10; i++ ) {
+      clockCtx.advance(300);
+    }
+    check("sub-second steps add up", clockCtx.now - startTime, 3);
+    clockCtx.advance(700);
+    check("remainder kept", clockCtx.now - startTime, 3);
+    clockCtx.advance(300);
+    check("remainder carried", clockCtx.now - startTime, 4);
+
+    enoughPower.listeners.remove(&handler);
+    haveRequiredPower.listeners.remove(&handler);
+    cout << "WhatIf tests complete" << endl;
+  }
+};
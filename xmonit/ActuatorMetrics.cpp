@@ -0,0 +1,114 @@
+
+#include "ActuatorMetrics.h"
+
+#include <Poco/JSON/JSONException.h>
+#include <Poco/Net/NetException.h>
+
+#include <algorithm>
+
+namespace xmonit {
+
+ActuatorMetrics ActuatorMetrics::instance;
+
+int LatencyHistogram::toIndex(unsigned long valueUs) {
+  if ( valueUs > MAX_US ) {
+    valueUs = MAX_US;
+  }
+  if ( valueUs < (unsigned long) SUB_BUCKET_CNT ) {
+    return valueUs;
+  }
+  int msb = sizeof(unsigned long) * 8 - 1 - __builtin_clzl(valueUs);
+  int shift = msb - SUB_BUCKET_BITS;
+  return SUB_BUCKET_CNT + shift * SUB_BUCKET_CNT + ((valueUs >> shift) & (SUB_BUCKET_CNT - 1));
+}
+
+unsigned long LatencyHistogram::highestInBucket(int index) {
+  if ( index < SUB_BUCKET_CNT ) {
+    return index;
+  }
+  int shift = (index - SUB_BUCKET_CNT) / SUB_BUCKET_CNT;
+  unsigned long lowest = (unsigned long) (SUB_BUCKET_CNT + (index - SUB_BUCKET_CNT) % SUB_BUCKET_CNT) << shift;
+  return lowest + (1UL << shift) - 1;
+}
+
+void LatencyHistogram::record(unsigned long valueUs) {
+  counts[toIndex(valueUs)]++;
+  count++;
+  unsigned long currentMax = maxUs;
+  while ( valueUs > currentMax && !maxUs.compare_exchange_weak(currentMax, valueUs) ) {
+  }
+}
+
+unsigned long LatencyHistogram::getPercentile(double percent) const {
+  unsigned long total = count;
+  if ( total == 0 ) {
+    return 0;
+  }
+  unsigned long rank = (unsigned long) (percent / 100.0 * total + 0.5);
+  if ( rank < 1 ) {
+    rank = 1;
+  }
+  unsigned long cnt = 0;
+  for ( int i = 0; i < BUCKET_CNT; i++ ) {
+    cnt += counts[i];
+    if ( cnt >= rank ) {
+      return std::min(highestInBucket(i), (unsigned long) maxUs);
+    }
+  }
+  return maxUs;
+}
+
+void ActuatorMetrics::record(const string& name, Result result, unsigned long durationUs) {
+  Actuator* pActuator;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Actuator>& pEntry = actuators[name];
+    if ( !pEntry ) {
+      pEntry.reset(new Actuator);
+    }
+    pActuator = pEntry.get(); // never removed
+  }
+  pActuator->latencyUs.record(durationUs);
+  pActuator->resultCnts[(int)result]++;
+  if ( listener ) {
+    listener(name, result, durationUs);
+  }
+}
+
+vector<ActuatorMetrics::Snapshot> ActuatorMetrics::getSnapshots() const {
+  vector<Snapshot> snapshots;
+  std::lock_guard<std::mutex> lock(mutex);
+  for ( auto& actuatorEntry : actuators ) {
+    const LatencyHistogram& latencyUs = actuatorEntry.second->latencyUs;
+    Snapshot snapshot { actuatorEntry.first, latencyUs.getCount(), latencyUs.getPercentile(50),
+                        latencyUs.getPercentile(95), latencyUs.getPercentile(99), latencyUs.getMax(), {} };
+    for ( int i = 0; i < RESULT_CNT; i++ ) {
+      snapshot.resultCnts[i] = actuatorEntry.second->resultCnts[i];
+    }
+    snapshots.push_back(snapshot);
+  }
+  return snapshots;
+}
+
+const char* ActuatorMetrics::getResultName(Result result) {
+  switch (result) {
+    case Result::Ok: return "ok";
+    case Result::Timeout: return "timeout";
+    case Result::HttpError: return "httpError";
+    case Result::ParseError: return "parseError";
+    default: return "error";
+  }
+}
+
+ActuatorMetrics::Result ActuatorMetrics::classify(const Poco::Exception& ex) {
+  if ( dynamic_cast<const Poco::TimeoutException*>(&ex) ) {
+    return Result::Timeout;
+  } else if ( dynamic_cast<const Poco::JSON::JSONException*>(&ex) || dynamic_cast<const Poco::SyntaxException*>(&ex) ) {
+    return Result::ParseError;
+  } else if ( dynamic_cast<const Poco::Net::HTTPException*>(&ex) ) {
+    return Result::HttpError;
+  }
+  return Result::Error;
+}
+
+}
@@ -0,0 +1,111 @@
+#ifndef XMONIT_ACTUATORMETRICS_H
+#define XMONIT_ACTUATORMETRICS_H
+
+#include "xmonit.h"
+#include "../automation/Automation.h"
+
+#include <Poco/Exception.h>
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+namespace xmonit {
+
+  // HDR style histogram of microsecond values: each power of two range is split into 32 linear sub buckets so
+  // percentiles are within ~3% while recording stays a few atomic increments.  Values over MAX_US go in the top bucket.
+  class LatencyHistogram {
+  public:
+    static const unsigned long MAX_US = 0xFFFFFFFFUL; // ~71 minutes (unsigned long is 32 bits on the pi)
+
+    void record(unsigned long valueUs);
+
+    unsigned long getCount() const { return count; }
+    unsigned long getMax() const { return maxUs; }
+
+    // highest value in the bucket holding the given percentile (0-100), 0 if nothing recorded
+    unsigned long getPercentile(double percent) const;
+
+  protected:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKET_CNT = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_CNT = SUB_BUCKET_CNT + (32 - SUB_BUCKET_BITS) * SUB_BUCKET_CNT;
+
+    std::atomic<unsigned long> counts[BUCKET_CNT] {};
+    std::atomic<unsigned long> count {0}, maxUs {0};
+
+    static int toIndex(unsigned long valueUs);
+    static unsigned long highestInBucket(int index);
+  };
+
+  // Timing and outcome of actuator calls (switch commands to openhab, xmonit and gpio) by device.  Switches time each
+  // command with a Call and the app exports the results to prometheus through listener.
+  class ActuatorMetrics {
+  public:
+
+    enum class Result { Ok, Timeout, HttpError, ParseError, Error };
+    static const int RESULT_CNT = 5;
+
+    struct Snapshot {
+      string name;
+      unsigned long count, p50Us, p95Us, p99Us, maxUs;
+      unsigned long resultCnts[RESULT_CNT];
+    };
+
+    // Times one call.  Records Error unless done() was called first (exception thrown by the call).
+    class Call {
+    public:
+      Call(const string& name, ActuatorMetrics& metrics = ActuatorMetrics::instance) :
+        name(name), metrics(metrics), startTime(std::chrono::steady_clock::now()) {
+      }
+
+      ~Call() {
+        if ( !bDone ) {
+          done(Result::Error);
+        }
+      }
+
+      void done(Result result) {
+        bDone = true;
+        unsigned long durationUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+        metrics.record(name, result, durationUs);
+      }
+
+      void done(const Poco::Exception& ex) { done(classify(ex)); }
+
+    protected:
+      string name;
+      ActuatorMetrics& metrics;
+      std::chrono::steady_clock::time_point startTime;
+      bool bDone = false;
+    };
+
+    // called after each recorded call on the thread that made it.  Set before switches are used.
+    std::function<void(const string& name, Result result, unsigned long durationUs)> listener;
+
+    void record(const string& name, Result result, unsigned long durationUs);
+
+    vector<Snapshot> getSnapshots() const;
+
+    static const char* getResultName(Result result);
+    static Result classify(const Poco::Exception& ex);
+    static Result classifyHttpStatus(int status) { return status >= 200 && status < 300 ? Result::Ok : Result::HttpError; }
+
+    static ActuatorMetrics instance;
+
+  protected:
+    struct Actuator {
+      LatencyHistogram latencyUs;
+      std::atomic<unsigned long> resultCnts[RESULT_CNT] {};
+    };
+
+    mutable std::mutex mutex;
+    std::map<string,std::unique_ptr<Actuator>> actuators;
+  };
+}
+#endif
@@ -0,0 +1,61 @@
+
+#include "DnsCache.h"
+
+#include <Poco/Net/DNS.h>
+#include <Poco/Net/IPAddress.h>
+#include <Poco/Exception.h>
+
+#include <iostream>
+
+namespace xmonit {
+
+DnsCache DnsCache::instance;
+
+DnsCache::DnsCache(unsigned long ttlMs) :
+  ttlMs(ttlMs),
+  resolver([](const string& host) { return Poco::Net::DNS::resolveOne(host).toString(); }) {
+}
+
+string DnsCache::resolve(const string& host) {
+  Poco::Net::IPAddress ip;
+  if ( Poco::Net::IPAddress::tryParse(host, ip) ) {
+    return host;
+  }
+  std::shared_ptr<Entry> pEntry;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Entry>& pCachedEntry = entries[host];
+    if ( !pCachedEntry ) {
+      pCachedEntry = std::make_shared<Entry>(*this, host);
+    }
+    pEntry = pCachedEntry;
+  }
+  string address = pEntry->getCachedValue(); // first lookup of a host waits for the resolver
+  if ( address.empty() ) {
+    // not resolved yet so try again next time instead of after ttlMs
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( entries[host] == pEntry ) {
+      entries.erase(host);
+    }
+  }
+  return address;
+}
+
+bool DnsCache::Entry::loadValue(string& address) const {
+  cache.lookupCnt++;
+  try {
+    address = cache.resolver(host);
+    return true;
+  } catch (Poco::Exception &ex) {
+    cache.failureCnt++;
+    if ( !isStale() ) {
+      cache.staleCnt++; // cache keeps answering with the last good address
+      cerr << __PRETTY_FUNCTION__ << " WARNING: " << host << " lookup failed so using last good address: " << ex.displayText() << endl;
+    } else {
+      cerr << __PRETTY_FUNCTION__ << " ERROR: " << host << " lookup failed: " << ex.displayText() << endl;
+    }
+    return false;
+  }
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef XMONIT_DNSCACHE_H
+#define XMONIT_DNSCACHE_H
+
+#include "xmonit.h"
+#include "../automation/Automation.h"
+#include "../automation/Cacheable.h"
+
+#include <Poco/Net/HTTPClientSession.h>
+#include <Poco/Net/SocketAddress.h>
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+namespace xmonit {
+
+  // Addresses of outbound hosts.  A lookup older than ttlMs is refreshed in the background while the cached address
+  // is still returned.  If the resolver fails the last good address keeps being used so a flaky local DNS server
+  // does not fail requests to hosts that have not moved.
+  class DnsCache {
+  public:
+
+    struct Stats {
+      unsigned long lookups;   // resolver calls
+      unsigned long failures;  // failed resolver calls
+      unsigned long stale;     // failures answered with the last good address
+    };
+
+    unsigned long ttlMs;
+
+    // looks up a host (throws Poco::Exception on failure).  Replaceable for tests.
+    std::function<string(const string&)> resolver;
+
+    DnsCache(unsigned long ttlMs = 5*automation::MINUTES);
+
+    // address of host as text or "" if it was never resolved
+    string resolve(const string& host);
+
+    Stats getStats() const {
+      return { lookupCnt, failureCnt, staleCnt };
+    }
+
+    static DnsCache instance;
+
+  protected:
+
+    struct Entry : public automation::AsyncCacheable<string> {
+      DnsCache& cache;
+      string host;
+
+      Entry(DnsCache& cache, const string& host) :
+        automation::AsyncCacheable<string>(cache.ttlMs, 0xFFFFFFFF, ""), // never too old since stale beats none
+        cache(cache),
+        host(host) {
+      }
+
+      ~Entry() {
+        joinRefresh();
+      }
+
+      bool loadValue(string& address) const override;
+    };
+
+    std::mutex mutex;
+    std::map<string,std::shared_ptr<Entry>> entries;
+    std::atomic<unsigned long> lookupCnt {0}, failureCnt {0}, staleCnt {0};
+  };
+
+  // Session that connects to the cached address of its host.  Poco sessions resolve the host on every connect.
+  template <class SessionT = Poco::Net::HTTPClientSession>
+  class CachedDnsSession : public SessionT {
+  public:
+    CachedDnsSession(const string& host, unsigned short port) : SessionT(host, port) {
+    }
+
+    // call before sendRequest().  Left to sendRequest() if the host was never resolved so it reports the error.
+    void connectCached() {
+      if ( this->connected() ) {
+        return;
+      }
+      string address = DnsCache::instance.resolve(this->getHost());
+      if ( !address.empty() ) {
+        this->connect(Poco::Net::SocketAddress(address, this->getPort()));
+      }
+    }
+  };
+}
+#endif
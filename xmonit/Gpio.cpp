@@ -0,0 +1,201 @@
+
+#include "Gpio.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/gpio.h>
+#endif
+
+namespace xmonit {
+
+std::unique_ptr<GpioBackend> GpioBackend::create(const string& type, const string& path) {
+  if ( type == "mock" ) {
+    return std::unique_ptr<GpioBackend>(new MockGpioBackend(path));
+  } else if ( type == "exec" ) {
+    return std::unique_ptr<GpioBackend>(new ExecGpioBackend);
+  }
+  std::unique_ptr<CharDevGpioBackend> pCharDev(new CharDevGpioBackend(path.empty() ? "/dev/gpiochip0" : path));
+  if ( !pCharDev->isOpen() ) {
+    cerr << __PRETTY_FUNCTION__ << " WARNING: " << pCharDev->chipPath << " not available so using gpio command" << endl;
+    return std::unique_ptr<GpioBackend>(new ExecGpioBackend);
+  }
+  return std::move(pCharDev);
+}
+
+std::unique_ptr<GpioBackend>& GpioBackend::defaultBackend() {
+  static std::unique_ptr<GpioBackend> pBackend;
+  return pBackend;
+}
+
+GpioBackend& GpioBackend::getDefault() {
+  std::unique_ptr<GpioBackend>& pBackend = defaultBackend();
+  if ( !pBackend ) {
+    pBackend = create("chardev", "/dev/gpiochip0");
+  }
+  return *pBackend;
+}
+
+void GpioBackend::setDefault(std::unique_ptr<GpioBackend> pBackend) {
+  defaultBackend() = std::move(pBackend);
+}
+
+int GpioBackend::wiringPiToBcm(int pin) {
+  // 40 pin header boards (17-20 were the P5 header of the rev 2 model B)
+  static const int BCM_PINS[] = { 17, 18, 27, 22, 23, 24, 25, 4, 2, 3, 8, 7, 10, 9, 11, 14,
+                                  15, 28, 29, 30, 31, 5, 6, 13, 19, 26, 12, 16, 20, 21, 0, 1 };
+  return pin >= 0 && pin < (int) (sizeof(BCM_PINS)/sizeof(BCM_PINS[0])) ? BCM_PINS[pin] : -1;
+}
+
+
+bool ExecGpioBackend::setOutput(int pin) {
+  string response;
+  return exec("gpio mode " + std::to_string(pin) + " out", response) == 0;
+}
+
+int ExecGpioBackend::read(int pin) {
+  string response;
+  if ( exec("gpio read " + std::to_string(pin), response) != 0 ) {
+    return -1;
+  }
+  automation::text::rtrim(response);
+  return response == "1" ? 1 : response == "0" ? 0 : -1;
+}
+
+bool ExecGpioBackend::write(int pin, bool bHigh) {
+  string response;
+  return exec("gpio write " + std::to_string(pin) + (bHigh ? " 1" : " 0"), response) == 0;
+}
+
+int ExecGpioBackend::exec(const string& cmd, string& strOutput) const {
+  std::array<char, 128> buffer;
+  strOutput.clear();
+  std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
+  if (!pipe) {
+      return -1;
+  }
+  while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
+      strOutput += buffer.data();
+  }
+  return 0;
+}
+
+
+CharDevGpioBackend::CharDevGpioBackend(const string& chipPath) :
+  chipPath(chipPath),
+  chipFd(open(chipPath.c_str(), O_RDONLY|O_CLOEXEC)) {
+}
+
+CharDevGpioBackend::~CharDevGpioBackend() {
+  for ( auto& pinFd : lineFds ) {
+    close(pinFd.second);
+  }
+  if ( chipFd >= 0 ) {
+    close(chipFd);
+  }
+}
+
+int CharDevGpioBackend::getLineFd(int pin) {
+  auto it = lineFds.find(pin);
+  if ( it != lineFds.end() ) {
+    return it->second;
+  }
+#ifdef __linux__
+  int line = wiringPiToBcm(pin);
+  if ( chipFd < 0 || line < 0 ) {
+    return -1;
+  }
+  struct gpiohandle_request req;
+  memset(&req, 0, sizeof(req));
+  req.lineoffsets[0] = line;
+  req.lines = 1;
+  strncpy(req.consumer_label, "solar-power-mgr", sizeof(req.consumer_label) - 1);
+
+  // no direction flags so the line is left as is while its level is read.  A relay still latched on from before a
+  // restart then stays on (like gpio mode out) instead of power cycling its load.
+  if ( ioctl(chipFd, GPIO_GET_LINEHANDLE_IOCTL, &req) >= 0 ) {
+    struct gpiohandle_data data;
+    memset(&data, 0, sizeof(data));
+    if ( ioctl(req.fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) >= 0 ) {
+      req.default_values[0] = data.values[0] ? 1 : 0;
+    }
+    close(req.fd);
+    req.fd = 0;
+  }
+  req.flags = GPIOHANDLE_REQUEST_OUTPUT;
+  if ( ioctl(chipFd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0 ) {
+    cerr << __PRETTY_FUNCTION__ << " ERROR: request of " << chipPath << " line " << line << " failed: " << strerror(errno) << endl;
+    return -1;
+  }
+  lineFds[pin] = req.fd;
+  return req.fd;
+#else
+  return -1;
+#endif
+}
+
+bool CharDevGpioBackend::setOutput(int pin) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return getLineFd(pin) >= 0;
+}
+
+int CharDevGpioBackend::read(int pin) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int fd = getLineFd(pin);
+#ifdef __linux__
+  struct gpiohandle_data data;
+  memset(&data, 0, sizeof(data));
+  if ( fd < 0 || ioctl(fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0 ) {
+    return -1;
+  }
+  return data.values[0] ? 1 : 0;
+#else
+  return -1;
+#endif
+}
+
+bool CharDevGpioBackend::write(int pin, bool bHigh) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int fd = getLineFd(pin);
+#ifdef __linux__
+  struct gpiohandle_data data;
+  memset(&data, 0, sizeof(data));
+  data.values[0] = bHigh ? 1 : 0;
+  return fd >= 0 && ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) >= 0;
+#else
+  return false;
+#endif
+}
+
+
+bool MockGpioBackend::setOutput(int pin) {
+  if ( read(pin) >= 0 ) {
+    return true;
+  }
+  return write(pin, false);
+}
+
+int MockGpioBackend::read(int pin) {
+  std::ifstream is(getPinPath(pin));
+  char c = 0;
+  if ( !(is >> c) ) {
+    return -1;
+  }
+  return c == '1' ? 1 : c == '0' ? 0 : -1;
+}
+
+bool MockGpioBackend::write(int pin, bool bHigh) {
+  std::ofstream os(getPinPath(pin), std::ios::trunc);
+  os << (bHigh ? "1" : "0") << endl;
+  return (bool) os;
+}
+
+}
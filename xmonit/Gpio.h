@@ -0,0 +1,100 @@
+#ifndef XMONIT_GPIO_H
+#define XMONIT_GPIO_H
+
+// Raspberry PI output pins for GpioPowerSwitch.  Pin numbers are WiringPi numbers (same as the gpio command).
+
+#include "xmonit.h"
+#include "../automation/Automation.h"
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace xmonit {
+
+  class GpioBackend {
+  public:
+    virtual ~GpioBackend() {}
+
+    virtual const char* getName() const = 0;
+
+    // configure pin as an output keeping its current level, returns false on failure
+    virtual bool setOutput(int pin) = 0;
+
+    // 0 or 1, -1 on failure
+    virtual int read(int pin) = 0;
+
+    virtual bool write(int pin, bool bHigh) = 0;
+
+    // "chardev" (falls back to "exec" if the chip can not be opened), "exec" or "mock".  path is the gpio chip
+    // device for chardev and the pin file directory for mock.
+    static std::unique_ptr<GpioBackend> create(const string& type, const string& path);
+
+    // backend used by switches not given one (chardev on /dev/gpiochip0 unless set)
+    static GpioBackend& getDefault();
+    static void setDefault(std::unique_ptr<GpioBackend> pBackend);
+
+    // BCM line offset of a WiringPi pin number, -1 if not a gpio
+    static int wiringPiToBcm(int pin);
+
+  protected:
+    static std::unique_ptr<GpioBackend>& defaultBackend();
+  };
+
+  // Legacy: runs the WiringPi gpio command for every call (a fork per read)
+  class ExecGpioBackend : public GpioBackend {
+  public:
+    const char* getName() const override { return "exec"; }
+    bool setOutput(int pin) override;
+    int read(int pin) override;
+    bool write(int pin, bool bHigh) override;
+
+  protected:
+    int exec(const string& cmd, string& strOutput) const;
+  };
+
+  // Linux gpio character device.  Each pin is requested once as an output line (initially at the level it had) and
+  // the line handle is kept open so reads and writes are a single ioctl.
+  class CharDevGpioBackend : public GpioBackend {
+  public:
+    string chipPath;
+
+    CharDevGpioBackend(const string& chipPath = "/dev/gpiochip0");
+    ~CharDevGpioBackend();
+
+    bool isOpen() const { return chipFd >= 0; }
+
+    const char* getName() const override { return "chardev"; }
+    bool setOutput(int pin) override;
+    int read(int pin) override;
+    bool write(int pin, bool bHigh) override;
+
+  protected:
+    int chipFd;
+    std::mutex mutex;
+    std::map<int,int> lineFds; // pin to line handle
+
+    // mutex held
+    int getLineFd(int pin);
+  };
+
+  // Pin state kept in files (dirPath/gpio<pin> containing 0 or 1) for tests and machines without gpio
+  class MockGpioBackend : public GpioBackend {
+  public:
+    string dirPath;
+
+    MockGpioBackend(const string& dirPath) : dirPath(dirPath) {
+    }
+
+    const char* getName() const override { return "mock"; }
+    bool setOutput(int pin) override;
+    int read(int pin) override;
+    bool write(int pin, bool bHigh) override;
+
+    string getPinPath(int pin) const {
+      return dirPath + "/gpio" + std::to_string(pin);
+    }
+  };
+}
+#endif
@@ -3,17 +3,15 @@
 
 #include "../automation/device/PowerSwitch.h"
 #include "xmonit.h"
-#include <sstream>
+#include "Gpio.h"
+#include "ActuatorMetrics.h"
 
-#include <cstdio>
 #include <iostream>
-#include <memory>
-#include <stdexcept>
 #include <string>
-#include <array>
 
 // simple Raspberry PI pin on/off implementation 
-// For external relays or powerstrips that just need a power signal
+// For external relays or powerstrips that just need a power signal.  Pins are accessed through GpioBackend
+// (default backend unless one is given).
 namespace xmonit {
 
 
@@ -23,9 +21,10 @@ namespace xmonit {
 
     int gpioPin;
 
-    GpioPowerSwitch(const string &id, int gpioPin, float requiredWatts = 0) : 
+    GpioPowerSwitch(const string &id, int gpioPin, float requiredWatts = 0, GpioBackend* pGpio = nullptr) : 
       automation::PowerSwitch(id,requiredWatts),
-      gpioPin(gpioPin) {
+      gpioPin(gpioPin),
+      pGpio(pGpio) {
     }
 
     void setup() override {
@@ -35,12 +34,8 @@ namespace xmonit {
         pConstraint->setRemoteExpiredOp(new Constraint::RemoteExpiredDelayOp(2*MINUTES));
         pConstraint->mode = (automation::Constraint::REMOTE_MODE|automation::Constraint::TEST_MODE);
       }
-      std::stringstream cmdStream;
-      cmdStream << "gpio mode " << gpioPin << " out";
-      std::string response;
-      int rtn = exec(cmdStream.str(),response);
-      automation::logBuffer << __PRETTY_FUNCTION__ << " cmd='" << cmdStream.str() << "' rtn=" << rtn << endl;
-      bError = rtn != 0;
+      bError = !gpio().setOutput(gpioPin);
+      automation::logBuffer << __PRETTY_FUNCTION__ << " pin=" << gpioPin << " gpio=" << gpio().getName() << " bError=" << bError << endl;
     }
 
     SetCode setAttribute(const char* pszKey, const char* pszVal, ostream* pRespStream = nullptr) override {
@@ -57,23 +52,19 @@ namespace xmonit {
 
 
     bool isOn() const override {
-      std::stringstream cmdStream;
-      cmdStream << "gpio read " << gpioPin;
-      std::string response;
-      int rtn = exec(cmdStream.str(),response);
-      automation::text::rtrim(response);
-      //automation::logBuffer << __PRETTY_FUNCTION__ << " cmd='" << cmdStream.str() << "' response='" << response << "'"<< endl;
-      bError = rtn != 0;
-      return !bError && response == "1";
+      int val = gpio().read(gpioPin);
+      bError = val < 0;
+      if ( !bError ) {
+        acknowledge(val == 1);
+      }
+      return val == 1;
     }
 
     void setOn(bool bOn) override {
-      std::stringstream cmdStream;
-      cmdStream << "gpio write " << gpioPin << " " << (bOn?"1":"0");
-      std::string response;
-      int rtn = exec(cmdStream.str(),response);
-      automation::logBuffer << __PRETTY_FUNCTION__ << " cmd='" << cmdStream.str() << "' rtn=" << rtn << endl;
-      bError = rtn != 0;
+      ActuatorMetrics::Call call(name);
+      bError = !gpio().write(gpioPin, bOn);
+      call.done(bError ? ActuatorMetrics::Result::Error : ActuatorMetrics::Result::Ok);
+      automation::logBuffer << __PRETTY_FUNCTION__ << " pin=" << gpioPin << " bOn=" << bOn << " bError=" << bError << endl;
       Constraint* pConstraint = getConstraint();
       if ( !bError && pConstraint ) {
         pConstraint->overrideTestResult(bOn);
@@ -81,17 +72,10 @@ namespace xmonit {
     }
 
     protected:
-    int exec(const std::string& cmd, std::string& strOutput) const {
-      std::array<char, 128> buffer;
-      strOutput.clear();
-      std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-      if (!pipe) {      
-          return -1;
-      }
-      while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-          strOutput += buffer.data();
-      }
-      return 0;
+    GpioBackend* pGpio;
+
+    GpioBackend& gpio() const {
+      return pGpio ? *pGpio : GpioBackend::getDefault();
     }
 
   };
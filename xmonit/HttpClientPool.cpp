@@ -0,0 +1,90 @@
+
+#include "HttpClientPool.h"
+#include "DnsCache.h"
+
+#include <Poco/Net/HTTPSClientSession.h>
+#include <Poco/Timespan.h>
+#include <Poco/Exception.h>
+
+#include <chrono>
+
+using namespace Poco::Net;
+
+namespace xmonit {
+
+HttpClientPool HttpClientPool::instance;
+
+HttpClientPool::~HttpClientPool() {
+  for ( auto& hostEntry : hosts ) {
+    for ( IdleSession& idle : hostEntry.second->idleSessions ) {
+      delete idle.pSession;
+    }
+  }
+}
+
+HttpClientPool::Lease HttpClientPool::acquire(const string& hostName, unsigned short port, bool bSecure) {
+  std::unique_lock<std::mutex> lock(mutex);
+  string key = (bSecure ? "https://" : "http://") + hostName + ":" + std::to_string(port);
+  std::unique_ptr<Host>& pHost = hosts[key];
+  if ( !pHost ) {
+    pHost.reset(new Host{hostName, port, bSecure});
+  }
+  Host& host = *pHost;
+  if ( !releasedCondition.wait_for(lock, std::chrono::milliseconds(connectTimeoutMs),
+                                   [this,&host]{ return !host.idleSessions.empty() || host.activeCnt < maxConnectionsPerHost; }) ) {
+    timeoutCnt++;
+    throw Poco::TimeoutException("No free HTTP connection to " + key);
+  }
+  HTTPClientSession* pSession;
+  if ( !host.idleSessions.empty() ) {
+    IdleSession idle = host.idleSessions.back(); // most recently used is the most likely to still be open
+    host.idleSessions.pop_back();
+    pSession = idle.pSession;
+    if ( automation::millisecs() - idle.idleSinceMs > keepAliveMs ) {
+      pSession->reset();
+    }
+  } else {
+    if ( bSecure ) {
+      pSession = new CachedDnsSession<HTTPSClientSession>(hostName, port);
+    } else {
+      pSession = new CachedDnsSession<>(hostName, port);
+    }
+    pSession->setKeepAlive(true);
+  }
+  pSession->setTimeout(Poco::Timespan(connectTimeoutMs*1000L), Poco::Timespan(readTimeoutMs*1000L), Poco::Timespan(readTimeoutMs*1000L));
+  pSession->setKeepAliveTimeout(Poco::Timespan((keepAliveMs + readTimeoutMs)*1000L)); // pool decides when idle sessions reconnect
+  host.activeCnt++;
+  leaseCnt++;
+  bool bConnected = pSession->connected();
+  if ( bConnected ) {
+    reuseCnt++;
+  } else {
+    connectCnt++;
+  }
+  Lease lease(*this, host, pSession);
+  lock.unlock();
+  if ( !bConnected ) {
+    // cached address instead of the lookup sendRequest() would do
+    if ( bSecure ) {
+      static_cast<CachedDnsSession<HTTPSClientSession>*>(pSession)->connectCached();
+    } else {
+      static_cast<CachedDnsSession<>*>(pSession)->connectCached();
+    }
+  }
+  return lease;
+}
+
+void HttpClientPool::release(Host& host, HTTPClientSession* pSession, bool bDone) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( !bDone ) {
+      pSession->reset();
+      discardCnt++;
+    }
+    host.idleSessions.push_back({pSession, automation::millisecs()});
+    host.activeCnt--;
+  }
+  releasedCondition.notify_all(); // waiters for other hosts share the condition
+}
+
+}
@@ -0,0 +1,108 @@
+#ifndef XMONIT_HTTPCLIENTPOOL_H
+#define XMONIT_HTTPCLIENTPOOL_H
+
+#include "xmonit.h"
+#include "../automation/Automation.h"
+
+#include <Poco/Net/HTTPClientSession.h>
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+namespace xmonit {
+
+  // Keep-alive HTTP(S) sessions shared by all outbound requests (xmonit, ifttt, prometheus and openhab).  Each host
+  // has at most maxConnectionsPerHost sessions and acquire() waits up to connectTimeoutMs for one to be returned.
+  // Sessions idle longer than keepAliveMs are reconnected since servers close idle connections.  Connections are made
+  // to the address from DnsCache.
+  class HttpClientPool {
+  public:
+
+    struct Stats {
+      unsigned long leases;    // acquire() calls that got a session
+      unsigned long connects;  // leases that had to open a connection
+      unsigned long reuses;    // leases that used an open connection
+      unsigned long discards;  // leases returned without done() so the connection was closed
+      unsigned long timeouts;  // acquire() calls that found no free session
+    };
+
+    struct Host;
+
+    // Session on loan from the pool.  Call done() once the response was read completely or the connection is closed
+    // when the lease is returned (failed requests may leave unread data behind).
+    class Lease {
+    public:
+      Lease(HttpClientPool& pool, Host& host, Poco::Net::HTTPClientSession* pSession) :
+        pool(pool), host(host), pSession(pSession) {
+      }
+
+      Lease(Lease&& other) : pool(other.pool), host(other.host), pSession(other.pSession), bDone(other.bDone) {
+        other.pSession = nullptr;
+      }
+
+      Lease(const Lease&) = delete;
+      Lease& operator=(const Lease&) = delete;
+
+      ~Lease() {
+        if ( pSession ) {
+          pool.release(host, pSession, bDone);
+        }
+      }
+
+      Poco::Net::HTTPClientSession& operator*() { return *pSession; }
+      Poco::Net::HTTPClientSession* operator->() { return pSession; }
+
+      void done() { bDone = true; }
+
+    protected:
+      HttpClientPool& pool;
+      Host& host;
+      Poco::Net::HTTPClientSession* pSession;
+      bool bDone = false;
+    };
+
+    unsigned long connectTimeoutMs = 5000;
+    unsigned long readTimeoutMs = 15000;
+    unsigned long keepAliveMs = 20000;
+    unsigned int maxConnectionsPerHost = 4;
+
+    HttpClientPool() {}
+    ~HttpClientPool();
+
+    // throws Poco::TimeoutException if all sessions to host stay in use for connectTimeoutMs
+    Lease acquire(const string& host, unsigned short port, bool bSecure = false);
+
+    Stats getStats() const {
+      return { leaseCnt, connectCnt, reuseCnt, discardCnt, timeoutCnt };
+    }
+
+    static HttpClientPool instance;
+
+  protected:
+    struct IdleSession {
+      Poco::Net::HTTPClientSession* pSession;
+      unsigned long idleSinceMs;
+    };
+
+    std::mutex mutex;
+    std::condition_variable releasedCondition;
+    std::map<string,std::unique_ptr<Host>> hosts;
+    std::atomic<unsigned long> leaseCnt {0}, connectCnt {0}, reuseCnt {0}, discardCnt {0}, timeoutCnt {0};
+
+    void release(Host& host, Poco::Net::HTTPClientSession* pSession, bool bDone);
+  };
+
+  struct HttpClientPool::Host {
+    string name;
+    unsigned short port;
+    bool bSecure;
+    std::vector<IdleSession> idleSessions;
+    unsigned int activeCnt = 0;
+  };
+}
+#endif
@@ -0,0 +1,148 @@
+
+#include "OneWireBus.h"
+
+#include <thread>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <math.h>
+
+namespace xmonit {
+
+void OneWireBus::add(const string& id, const string& dirPath) {
+  probes.push_back({id, dirPath, NAN, 0});
+}
+
+float OneWireBus::getTemperature(const string& id) {
+  std::lock_guard<std::mutex> lock(refreshMutex);
+  if ( !bRefreshed || automation::millisecs() - lastRefreshMs > maxCacheAgeMs ) {
+    refreshProbes();
+  }
+  for ( const Probe& probe : probes ) {
+    if ( probe.id == id ) {
+      return probe.celcius;
+    }
+  }
+  return NAN;
+}
+
+void OneWireBus::refresh() {
+  std::lock_guard<std::mutex> lock(refreshMutex);
+  refreshProbes();
+}
+
+void OneWireBus::refreshProbes() {
+  triggerBulkConversion();
+  vector<std::thread> readers;
+  readers.reserve(probes.size());
+  for ( Probe& probe : probes ) {
+    readers.emplace_back([&probe]() {
+      probe.celcius = readProbe(probe.dirPath);
+      probe.readTimeMs = automation::millisecs();
+    });
+  }
+  for ( std::thread& reader : readers ) {
+    reader.join();
+  }
+  lastRefreshMs = automation::millisecs();
+  bRefreshed = true;
+}
+
+// Start conversion on every probe of every bus master.  Probes then return the converted value without waiting
+// on their own conversion.  Kernels without therm_bulk_read still work, each read just waits for its conversion.
+void OneWireBus::triggerBulkConversion() const {
+  DIR* pDir = opendir(devicesPath.c_str());
+  if ( !pDir ) {
+    return;
+  }
+  static const char TRIGGER[] = "trigger\n";
+  while ( struct dirent* pEntry = readdir(pDir) ) {
+    if ( strncmp(pEntry->d_name, "w1_bus_master", 13) != 0 ) {
+      continue;
+    }
+    string path = devicesPath + "/" + pEntry->d_name + "/therm_bulk_read";
+    int fd = open(path.c_str(), O_WRONLY);
+    if ( fd >= 0 ) {
+      if ( write(fd, TRIGGER, sizeof(TRIGGER)-1) < 0 ) {
+        cerr << __PRETTY_FUNCTION__ << " ERROR[one-wire path='" << path << "']: " << strerror(errno) << endl;
+      }
+      close(fd);
+    }
+  }
+  closedir(pDir);
+}
+
+float OneWireBus::readProbe(const string& dirPath) {
+  char buf[128];
+  float celcius;
+  if ( readFile(dirPath + "/temperature", buf, sizeof(buf)) ) {
+    if ( parseTemperature(buf, celcius) ) {
+      return celcius;
+    }
+  } else if ( readFile(dirPath + "/w1_slave", buf, sizeof(buf)) ) {
+    if ( parseW1Slave(buf, celcius) ) {
+      return celcius;
+    }
+  } else {
+    cerr << __PRETTY_FUNCTION__ << " ERROR[one-wire path='" << dirPath << "']: Failed reading temperature" << endl;
+    return NAN;
+  }
+  cerr << __PRETTY_FUNCTION__ << " ERROR[one-wire path='" << dirPath << "']: Unexpected content [" << buf << "]" << endl;
+  return NAN;
+}
+
+bool OneWireBus::readFile(const string& path, char* pBuf, size_t bufSize) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if ( fd < 0 ) {
+    return false;
+  }
+  size_t len = 0;
+  ssize_t cnt = 0;
+  while ( len < bufSize - 1 && (cnt = read(fd, pBuf + len, bufSize - 1 - len)) > 0 ) {
+    len += cnt;
+  }
+  close(fd);
+  pBuf[len] = '\0';
+  return cnt >= 0 && len > 0;
+}
+
+bool OneWireBus::parseTemperature(const char* pText, float& celcius) {
+  const char* p = pText;
+  while ( *p == ' ' ) {
+    p++;
+  }
+  bool bNegative = *p == '-';
+  if ( bNegative ) {
+    p++;
+  }
+  if ( *p < '0' || *p > '9' ) {
+    return false;
+  }
+  long milliDegrees = 0;
+  for ( ; *p >= '0' && *p <= '9'; p++ ) {
+    milliDegrees = milliDegrees * 10 + (*p - '0');
+  }
+  while ( *p == ' ' || *p == '\n' || *p == '\r' ) {
+    p++;
+  }
+  if ( *p ) {
+    return false;
+  }
+  celcius = (bNegative ? -milliDegrees : milliDegrees) / 1000.0;
+  return true;
+}
+
+// 72 01 4b 46 7f ff 0e 10 57 : crc=57 YES
+// 72 01 4b 46 7f ff 0e 10 57 t=23125
+bool OneWireBus::parseW1Slave(const char* pText, float& celcius) {
+  const char* pLineEnd = strchr(pText, '\n');
+  if ( !pLineEnd || pLineEnd - pText < 3 || strncmp(pLineEnd - 3, "YES", 3) != 0 ) {
+    return false; // crc check failed
+  }
+  const char* pTemp = strstr(pLineEnd, "t=");
+  return pTemp && parseTemperature(pTemp + 2, celcius);
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef XMONIT_ONEWIREBUS_H
+#define XMONIT_ONEWIREBUS_H
+
+// Reads all DS18B20 probes of the w1 sysfs tree together instead of one blocking read per sensor
+
+#include "xmonit.h"
+#include "../automation/Automation.h"
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace xmonit {
+
+  // Temperatures of every probe are refreshed at once when a reading older than maxCacheAgeMs is requested.  A
+  // refresh writes "trigger" to each bus master's therm_bulk_read so all probes convert at the same time, then
+  // reads each probe's "temperature" file (or "w1_slave" on older kernels) on its own thread.  Results are shared
+  // by all sensors on the bus.
+  class OneWireBus {
+  public:
+
+    struct Probe {
+      string id;       // sysfs directory name (28-xxxxxxxxxxxx)
+      string dirPath;
+      float celcius;
+      unsigned long readTimeMs;
+    };
+
+    string devicesPath;
+    unsigned long maxCacheAgeMs;
+
+    OneWireBus(const string& devicesPath = "/sys/bus/w1/devices", unsigned long maxCacheAgeMs = 60000) :
+      devicesPath(devicesPath),
+      maxCacheAgeMs(maxCacheAgeMs) {
+    }
+
+    // call before readings are requested
+    void add(const string& id, const string& dirPath);
+
+    // NAN if id unknown or its last read failed
+    float getTemperature(const string& id);
+
+    // bulk conversion and parallel read of all probes
+    void refresh();
+
+    size_t size() const { return probes.size(); }
+
+    // parse contents of "temperature" (millidegrees) or "w1_slave" (crc line ending YES then t=millidegrees)
+    static bool parseTemperature(const char* pText, float& celcius);
+    static bool parseW1Slave(const char* pText, float& celcius);
+
+  protected:
+    vector<Probe> probes;
+    std::mutex refreshMutex;
+    unsigned long lastRefreshMs = 0;
+    bool bRefreshed = false;
+
+    void refreshProbes();
+    void triggerBulkConversion() const;
+    static float readProbe(const string& dirPath);
+    static bool readFile(const string& path, char* pBuf, size_t bufSize);
+  };
+}
+#endif
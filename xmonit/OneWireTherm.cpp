@@ -2,58 +2,14 @@
 #include "OneWireTherm.h"
 
 #include "Poco/Glob.h"
-#include "Poco/StreamCopier.h"
-#include "Poco/Exception.h"
-#include "Poco/NumberParser.h"
 #include "Poco/Path.h"
-#include "Poco/FileStream.h"
 #include "Poco/Util/LayeredConfiguration.h"
-#include "Poco/RegularExpression.h"
-
-#include <fstream>
 
 namespace xmonit {
 
-float OneWireThermSensor::getValueImpl() const {
-
-  //cout << __PRETTY_FUNCTION__ << " name=" << name << ", fileName=" << filePath << ", title=" << title << endl;
-
-  float fTempCelcius(0);
-  std::string line;
-
-  auto errorFormatter = [this](const string& msg) { 
-    stringstream sstr;
-    sstr << "ERROR[one-wire name='" << name << "' path='" << filePath << "']: " << msg; 
-    return sstr.str();
-  };
-
-  try {    
-    
-    ifstream fis(filePath, std::ios::in);
-    const static Poco::RegularExpression HAS_YES_SUFFIX(".*YES$");
-    const static Poco::RegularExpression HAS_5DIGIT_TEMP_SUFFIX(".*t=-?[0-9]+$");
-
-    if ( !std::getline(fis,line) ) {
-      throw Poco::Exception(errorFormatter("Failed reading first line"));
-    } else if ( !HAS_YES_SUFFIX.match(line) ) {
-      throw Poco::Exception(errorFormatter("Expected regex \".*YES\" at end of first line. [")+ line + "]");
-    } else if ( !std::getline(fis,line) ) {
-      throw Poco::Exception(errorFormatter("Failed reading second line"));
-    } else if ( !HAS_5DIGIT_TEMP_SUFFIX.match(line) ) {
-      throw Poco::Exception(errorFormatter("Expected regex \".*t=-?[0-9]+$\" on second line. [") + line + "]");
-    } else {
-      int iTemperatureData = Poco::NumberParser::parse(line.substr(line.size()-5));
-      fTempCelcius = iTemperatureData / 1000.0;
-    }
-  } catch ( const Poco::Exception& ex ) {
-    cerr << __PRETTY_FUNCTION__ << " " << ex.displayText() << endl;
-    fTempCelcius = NAN;
-  } catch ( ... ) {
-    cerr << __PRETTY_FUNCTION__ << errorFormatter("Unhandled exception") << endl;
-    fTempCelcius = NAN;
-  }
-
-  return fTempCelcius;
+bool OneWireThermSensor::loadValue(float& temp) const {
+  temp = pBus->getTemperature(name);
+  return !isnan(temp);
 }
 
 void OneWireThermSensor::createSensors(Poco::Util::LayeredConfiguration& conf, vector<unique_ptr<OneWireThermSensor>>& sensors) {
@@ -62,6 +18,9 @@ void OneWireThermSensor::createSensors(Poco::Util::LayeredConfiguration& conf, v
   std::string path = conf.getString("oneWire[@path]", "/sys/bus/w1/devices");
   std::string search = path + "/" + filter + "/w1_slave";
   unsigned long maxCacheAgeMs = conf.getDouble("oneWire.maxCacheAgeMs",60000);
+  unsigned long maxStaleAgeMs = conf.getDouble("oneWire.maxStaleAgeMs",5*maxCacheAgeMs);
+  // bus readings expire before sensor caches so the first sensor to expire refreshes all probes
+  auto pBus = std::make_shared<OneWireBus>(path, maxCacheAgeMs/2);
   std::set<string> fileNames;
   Poco::Glob::glob(search.c_str(),fileNames);
   
@@ -70,7 +29,8 @@ void OneWireThermSensor::createSensors(Poco::Util::LayeredConfiguration& conf, v
       string xpath = string("oneWire.titles.title[@id='") + name + "'][@value]";
       string title = conf.getString( xpath, name);
       cout << __PRETTY_FUNCTION__ << " name=" << name << ", fileName=" << fileName << ", title=" << title << ", xpath=" << xpath << endl;
-      sensors.push_back( make_unique<OneWireThermSensor>(name,fileName,title, maxCacheAgeMs));
+      pBus->add(name, fileName.substr(0, fileName.rfind('/')));
+      sensors.push_back( make_unique<OneWireThermSensor>(name,pBus,title, maxCacheAgeMs, maxStaleAgeMs));
   }
 }
 
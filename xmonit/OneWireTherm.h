@@ -4,6 +4,7 @@
 // sensor backed by a "one-wire" temp sensor (DS18B20) 
 
 #include "xmonit.h"
+#include "OneWireBus.h"
 #include "../automation/sensor/Sensor.h"
 #include "../automation/Cacheable.h"
 
@@ -11,36 +12,38 @@
 
 namespace xmonit {
 
-  class OneWireThermSensor : public automation::Sensor, public automation::Cacheable<float> {
+  // Value comes from an AsyncCacheable so reading it never waits on the bus.  After maxCacheAgeMs the last
+  // temperature is used while the bus refreshes in the background.  After maxStaleAgeMs without a good reading
+  // the value is NAN.
+  class OneWireThermSensor : public automation::Sensor, public automation::AsyncCacheable<float> {
   public:
     RTTI_GET_TYPE_IMPL(xmonit,OneWireThermSensor);
 
-    string title, filePath;
-    unsigned long maxCacheAgeMs;
+    string title;
+    std::shared_ptr<OneWireBus> pBus; // shared by all sensors so one refresh reads every probe
 
-    OneWireThermSensor(const string &name, const string& filePath, const string &title, const unsigned long maxCacheAgeMs = 60000 ) : 
+    OneWireThermSensor(const string &name, const std::shared_ptr<OneWireBus>& pBus, const string &title,
+                       const unsigned long maxCacheAgeMs = 60000, const unsigned long maxStaleAgeMs = 300000 ) : 
       automation::Sensor(name,1),
+      automation::AsyncCacheable<float>(maxCacheAgeMs, maxStaleAgeMs, NAN),
       title(title),
-      filePath(filePath),
-      maxCacheAgeMs(maxCacheAgeMs) {
+      pBus(pBus) {
         
     }
+
+    ~OneWireThermSensor() {
+      joinRefresh();
+    }
     
-    virtual float getValueImpl() const override;
+    virtual float getValueImpl() const override {
+      return getCachedValue();
+    }
     
     virtual string getTitle() const override {
       return title;
     }
 
-    virtual float getValueNow() const override {
-      float nowVal = ((Sensor*)this)->reset().getValue();
-      //cout << __PRETTY_FUNCTION__ << " nowVal=" << nowVal << endl;
-      return nowVal;
-    }
-
-    virtual unsigned long getMaxCacheAgeMs() const override {
-      return maxCacheAgeMs;
-    }
+    virtual bool loadValue(float& temp) const override;
 
     static void createSensors(Poco::Util::LayeredConfiguration& conf, vector<unique_ptr<OneWireThermSensor>>& sensors);
      
@@ -0,0 +1,291 @@
+
+#include "OpenHabClient.h"
+
+#include <Poco/JSON/Parser.h>
+#include <Poco/JSON/ParseHandler.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/URI.h>
+#include <Poco/String.h>
+#include <Poco/Exception.h>
+
+#include <sstream>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <math.h>
+
+using namespace Poco::Net;
+
+namespace xmonit {
+
+OpenHabClient OpenHabClient::instance;
+
+// Picks name and state out of each item object as the parser reads it (no JSON document is built)
+class ItemStateHandler : public Poco::JSON::ParseHandler {
+public:
+  ItemStateHandler(const std::set<string>& items, std::map<string,string>& states) : items(items), states(states) {
+  }
+
+  void reset() override {
+    depth = 0;
+    currentKey.clear();
+  }
+
+  void startObject() override {
+    if ( ++depth == ITEM_DEPTH ) {
+      name.clear();
+      state.clear();
+    }
+  }
+
+  void endObject() override {
+    if ( depth-- == ITEM_DEPTH && items.count(name) ) {
+      states[name] = state;
+    }
+  }
+
+  void startArray() override { depth++; }
+  void endArray() override { depth--; }
+
+  void key(const std::string& k) override {
+    if ( depth == ITEM_DEPTH ) {
+      currentKey = k;
+    }
+  }
+
+  void value(const std::string& v) override {
+    if ( depth == ITEM_DEPTH ) {
+      if ( currentKey == "name" ) {
+        name = v;
+      } else if ( currentKey == "state" ) {
+        state = v;
+      }
+    }
+  }
+
+  // other values are not needed (and ParseHandler's versions would add them to a document)
+  void null() override {}
+  void value(int v) override {}
+  void value(unsigned v) override {}
+#if defined(POCO_HAVE_INT64)
+  void value(Poco::Int64 v) override {}
+  void value(Poco::UInt64 v) override {}
+#endif
+  void value(double d) override {}
+  void value(bool b) override {}
+
+protected:
+  static const int ITEM_DEPTH = 2; // objects in the top level array
+  const std::set<string>& items;
+  std::map<string,string>& states;
+  int depth = 0;
+  string currentKey, name, state;
+};
+
+bool OpenHabClient::parseStates(std::istream& is, const std::set<string>& items, std::map<string,string>& states) {
+  try {
+    Poco::JSON::Parser parser(new ItemStateHandler(items, states));
+    parser.parse(is);
+    return true;
+  } catch (Poco::Exception &ex) {
+    cerr << __PRETTY_FUNCTION__ << " ERROR: Failed parsing item states: " << ex.displayText() << endl;
+    return false;
+  }
+}
+
+float OpenHabClient::getState(const string& itemName) {
+  std::unique_lock<std::mutex> lock(mutex);
+  fetchCondition.wait(lock, [this]{ return !bFetching; }); // share a fetch already running
+  if ( !bFetched || ((!bPushConnected || !bLastFetchOk) && automation::millisecs() - lastFetchMs > maxStateAgeMs) ) {
+    fetchStatesLocked(lock);
+  }
+  auto it = states.find(itemName);
+  return it == states.end() ? NAN : toState(it->second);
+}
+
+void OpenHabClient::pushState(const string& itemName, const string& state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( !items.count(itemName) ) {
+      return;
+    }
+    states[itemName] = state;
+    if ( bFetching ) {
+      pushedWhileFetching.insert(itemName);
+    }
+  }
+  queueEvents({{itemName, toState(state)}});
+}
+
+void OpenHabClient::queueEvents(const std::vector<std::pair<string,float>>& events) {
+  if ( events.empty() ) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    pendingEvents.insert(pendingEvents.end(), events.begin(), events.end());
+  }
+  eventCondition.notify_all();
+}
+
+bool OpenHabClient::waitForEvents(unsigned long timeoutMs) {
+  std::unique_lock<std::mutex> lock(eventMutex);
+  return eventCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]{ return !pendingEvents.empty(); });
+}
+
+size_t OpenHabClient::dispatchEvents() {
+  std::vector<std::pair<string,float>> events;
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    events.swap(pendingEvents);
+  }
+  for ( auto& event : events ) {
+    std::vector<ItemListener*> itemListeners;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto range = listeners.equal_range(event.first);
+      for ( auto it = range.first; it != range.second; it++ ) {
+        itemListeners.push_back(it->second);
+      }
+    }
+    for ( ItemListener* pListener : itemListeners ) {
+      pListener->itemStateChanged(event.first, event.second);
+    }
+  }
+  return events.size();
+}
+
+bool OpenHabClient::fetchStates() {
+  std::unique_lock<std::mutex> lock(mutex);
+  fetchCondition.wait(lock, [this]{ return !bFetching; }); // may have started before a change the caller expects
+  return fetchStatesLocked(lock);
+}
+
+bool OpenHabClient::fetchStatesLocked(std::unique_lock<std::mutex>& lock) {
+  bFetched = true;
+  bFetching = true;
+  lastFetchMs = automation::millisecs(); // also when failed so a down server is not asked by every switch
+  pushedWhileFetching.clear();
+  string uri = "/rest/items?fields=name,state";
+  if ( !tag.empty() ) {
+    string encodedTag;
+    Poco::URI::encode(tag, "&=?#", encodedTag);
+    uri += "&tags=" + encodedTag;
+  }
+  string fetchHost = host;
+  unsigned short fetchPort = port;
+  std::set<string> fetchItems = items;
+  std::map<string,string> fetchedStates;
+
+  lock.unlock();
+  bool bOk = requestStates(fetchHost, fetchPort, uri, fetchItems, fetchedStates);
+  lock.lock();
+
+  std::vector<std::pair<string,float>> changes;
+  if ( bOk ) {
+    for ( const string& itemName : pushedWhileFetching ) {
+      auto it = states.find(itemName);
+      if ( it != states.end() ) {
+        fetchedStates[itemName] = it->second;
+      }
+    }
+    for ( auto& fetched : fetchedStates ) {
+      auto it = states.find(fetched.first);
+      if ( it == states.end() || it->second != fetched.second ) {
+        changes.push_back({fetched.first, toState(fetched.second)});
+      }
+    }
+    states.swap(fetchedStates);
+  } else {
+    states.clear();
+  }
+  bLastFetchOk = bOk;
+  bFetching = false;
+  fetchCondition.notify_all();
+  queueEvents(changes); // changes missed while the event stream was disconnected
+  return bOk;
+}
+
+bool OpenHabClient::requestStates(const string& host, unsigned short port, const string& uri, const std::set<string>& items,
+                                  std::map<string,string>& fetchedStates) {
+  try {
+    HttpClientPool::Lease pSession = HttpClientPool::instance.acquire(host, port);
+    HTTPRequest req(HTTPRequest::HTTP_GET, uri, HTTPRequest::HTTP_1_1);
+    pSession->sendRequest(req);
+    HTTPResponse resp;
+    istream &is = pSession->receiveResponse(resp);
+    if ( resp.getStatus() != HTTPResponse::HTTP_OK ) {
+      cerr << __PRETTY_FUNCTION__ << " ERROR: GET " << uri << " status " << resp.getStatus() << " " << resp.getReason() << endl;
+      return false;
+    }
+    if ( !parseStates(is, items, fetchedStates) ) {
+      return false;
+    }
+    pSession.done();
+  } catch (Poco::Exception &ex) {
+    cerr << __PRETTY_FUNCTION__ << " ERROR: Failed HTTP request: GET " << uri << endl;
+    cerr << ex.displayText() << endl;
+    return false;
+  }
+  return true;
+}
+
+Poco::JSON::Object::Ptr OpenHabClient::processRequest(const string& httpMethod, const string& uri, const string& httpBody, const string& contentType,
+                                                      ActuatorMetrics::Result* pResult) {
+  string httpHeaderLine1;
+  Poco::JSON::Object::Ptr resultPtr;
+  string requestHost;
+  unsigned short requestPort;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    requestHost = host;
+    requestPort = port;
+  }
+  try{
+    HttpClientPool::Lease pSession = HttpClientPool::instance.acquire(requestHost, requestPort);
+    HTTPRequest req(httpMethod, uri, HTTPRequest::HTTP_1_1);
+    req.setContentType(contentType);
+    req.setContentLength(httpBody.length());
+
+    stringstream ss;
+    req.write(ss);
+    getline(ss,httpHeaderLine1);
+    httpHeaderLine1 = Poco::replace(httpHeaderLine1,'\r');
+
+    ostream &os = pSession->sendRequest(req);
+    os << httpBody;
+
+    HTTPResponse resp;
+    istream &is = pSession->receiveResponse(resp);
+    if ( pResult ) {
+      *pResult = ActuatorMetrics::classifyHttpStatus(resp.getStatus());
+    }
+    if ( contentType == "application/json" ) {
+      Poco::JSON::Parser parser;
+      Poco::Dynamic::Var result = parser.parse(is);
+      resultPtr = result.extract<Poco::JSON::Object::Ptr>();
+    } else {
+      resultPtr = new Poco::JSON::Object;
+      Poco::Dynamic::Var status = (int) resp.getStatus();
+      resultPtr->set("status", status);
+      resultPtr->set("reason", resp.getReason());
+    }
+    is.ignore(std::numeric_limits<std::streamsize>::max()); // keep the connection usable for the next request
+    pSession.done();
+  }
+  catch (Poco::Exception &ex)
+  {
+    cerr << __PRETTY_FUNCTION__ << " ERROR: Failed HTTP request: " <<  httpHeaderLine1 << endl;
+    cerr << ex.displayText() << endl;
+    resultPtr = new Poco::JSON::Object;
+    resultPtr->set("status", 500);
+    resultPtr->set("reason", ex.displayText() );
+    if ( pResult ) {
+      *pResult = ActuatorMetrics::classify(ex);
+    }
+  }
+  return resultPtr;
+}
+
+}
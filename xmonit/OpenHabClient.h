@@ -0,0 +1,131 @@
+#ifndef XMONIT_OPENHABCLIENT_H
+#define XMONIT_OPENHABCLIENT_H
+
+#include "xmonit.h"
+#include "../automation/Automation.h"
+#include "HttpClientPool.h"
+#include "ActuatorMetrics.h"
+
+#include <Poco/JSON/Object.h>
+
+#include <string>
+#include <set>
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+
+namespace xmonit {
+
+  // OpenHAB REST client shared by all OpenHabSwitch instances (connections come from HttpClientPool).  Item states
+  // are fetched for all tracked items with a single GET /rest/items?fields=name,state (optionally limited to items
+  // with a tag) and parsed without building a JSON document.  States older than maxStateAgeMs are fetched again on
+  // the next request so switches refreshing at about the same time share one fetch.  The GET runs without holding
+  // the client lock so commands and pushed events are not held up by it.
+  //
+  // While an OpenHabEventStream is connected states are kept current by pushed events instead of fetching (polling
+  // goes on until a fetch succeeds).
+  // Pushed changes and changes found by a fetch are queued for dispatchEvents() so item listeners run on the
+  // caller's (main loop) thread.
+  class OpenHabClient {
+  public:
+
+    struct ItemListener {
+      virtual void itemStateChanged(const string& itemName, float state) = 0;
+    };
+
+    string tag;
+    unsigned long maxStateAgeMs;
+
+    OpenHabClient(const string& host = "openhab", unsigned short port = 8080, const string& tag = "", unsigned long maxStateAgeMs = 5000) :
+      tag(tag),
+      maxStateAgeMs(maxStateAgeMs),
+      host(host),
+      port(port) {
+    }
+
+    void configure(const string& host, unsigned short port, const string& tag) {
+      std::lock_guard<std::mutex> lock(mutex);
+      this->host = host;
+      this->port = port;
+      this->tag = tag;
+    }
+
+    void track(const string& itemName, ItemListener* pListener = nullptr) {
+      std::lock_guard<std::mutex> lock(mutex);
+      items.insert(itemName);
+      if ( pListener ) {
+        listeners.insert({itemName, pListener});
+      }
+    }
+
+    std::vector<string> getTrackedItems() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return std::vector<string>(items.begin(), items.end());
+    }
+
+    // 1 for ON, 0 for OFF and NAN if the fetch failed or the item has no ON/OFF state
+    float getState(const string& itemName);
+
+    // fetch states of all tracked items now (after waiting for a fetch already running), returns false on failure
+    bool fetchStates();
+
+    // request on a pooled connection.  JSON responses are returned as is, others as {"status":...,"reason":...}.
+    // pResult gets the outcome for ActuatorMetrics.
+    Poco::JSON::Object::Ptr processRequest(const string& httpMethod, const string& uri, const string& httpBody,
+                                           const string& contentType = "application/json",
+                                           ActuatorMetrics::Result* pResult = nullptr);
+
+    // parse [{"name":"...","state":"..."},...] from is into states (only tracked items)
+    static bool parseStates(std::istream& is, const std::set<string>& items, std::map<string,string>& states);
+
+    // event stream connected so states are current without fetching
+    void setPushConnected(bool bConnected) { bPushConnected = bConnected; }
+    bool isPushConnected() const { return bPushConnected; }
+
+    // state change pushed by the event stream (ignored if item not tracked)
+    void pushState(const string& itemName, const string& state);
+
+    // wait up to timeoutMs for pushed changes, returns true if any are queued
+    bool waitForEvents(unsigned long timeoutMs);
+
+    // tell item listeners about queued changes, returns number of changes
+    size_t dispatchEvents();
+
+    static float toState(const string& state) {
+      return state == "ON" ? 1 : state == "OFF" ? 0 : NAN;
+    }
+
+    static OpenHabClient instance;
+
+  protected:
+    std::mutex mutex;
+    std::condition_variable fetchCondition;
+    std::multimap<string,ItemListener*> listeners;
+    std::atomic<bool> bPushConnected {false};
+    std::mutex eventMutex;
+    std::condition_variable eventCondition;
+    std::vector<std::pair<string,float>> pendingEvents;
+    string host;
+    unsigned short port;
+    std::set<string> items;
+    std::map<string,string> states;
+    unsigned long lastFetchMs = 0;
+    bool bFetched = false;
+    bool bLastFetchOk = false; // pushed events only keep states current after a good fetch
+    bool bFetching = false;
+    std::set<string> pushedWhileFetching; // newer than what the running fetch will return
+
+    // called with lock held and no fetch running.  The lock is released during the GET.
+    bool fetchStatesLocked(std::unique_lock<std::mutex>& lock);
+
+    // GET of item states into fetchedStates (no lock held)
+    static bool requestStates(const string& host, unsigned short port, const string& uri, const std::set<string>& items,
+                              std::map<string,string>& fetchedStates);
+
+    void queueEvents(const std::vector<std::pair<string,float>>& events);
+  };
+}
+#endif
@@ -0,0 +1,134 @@
+
+#include "OpenHabEventStream.h"
+
+#include <Poco/JSON/Parser.h>
+#include <Poco/JSON/Object.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Timespan.h>
+#include <Poco/Exception.h>
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+using namespace Poco::Net;
+
+namespace xmonit {
+
+OpenHabEventStream::OpenHabEventStream(OpenHabClient& client, const string& host, unsigned short port, const string& topicPrefix) :
+  topicPrefix(topicPrefix),
+  client(client),
+  session(host, port) {
+  session.setTimeout(Poco::Timespan(15*60, 0)); // openhab sends nothing while items do not change
+}
+
+void OpenHabEventStream::start() {
+  bStop = false;
+  worker = std::thread(&OpenHabEventStream::run, this);
+}
+
+void OpenHabEventStream::stop() {
+  {
+    std::lock_guard<std::mutex> lock(stopMutex);
+    bStop = true;
+  }
+  stopCondition.notify_all();
+  if ( worker.joinable() ) {
+    session.abort(); // unblock read of the stream
+    worker.join();
+  }
+}
+
+void OpenHabEventStream::run() {
+  unsigned long backoffMs = minBackoffMs;
+  std::unique_lock<std::mutex> lock(stopMutex);
+  while ( !bStop ) {
+    lock.unlock();
+    unsigned long connectCntBefore = connectCnt;
+    stream();
+    if ( connectCnt != connectCntBefore ) {
+      backoffMs = minBackoffMs; // was connected so start over
+    }
+    lock.lock();
+    if ( stopCondition.wait_for(lock, std::chrono::milliseconds(backoffMs), [this]{ return bStop.load(); }) ) {
+      break;
+    }
+    backoffMs = std::min(backoffMs * 2, maxBackoffMs);
+  }
+}
+
+void OpenHabEventStream::stream() {
+  string uri = "/rest/events?topics=";
+  std::vector<string> items = client.getTrackedItems();
+  for ( size_t i = 0; i < items.size(); i++ ) {
+    uri += (i ? "," : "") + topicPrefix + "/" + items[i] + "/statechanged";
+  }
+  try {
+    HTTPRequest req(HTTPRequest::HTTP_GET, uri, HTTPRequest::HTTP_1_1);
+    req.set("Accept", "text/event-stream");
+    session.connectCached();
+    session.sendRequest(req);
+    HTTPResponse resp;
+    istream& is = session.receiveResponse(resp);
+    if ( resp.getStatus() != HTTPResponse::HTTP_OK ) {
+      cerr << __PRETTY_FUNCTION__ << " ERROR: GET " << uri << " status " << resp.getStatus() << " " << resp.getReason() << endl;
+      session.reset();
+      return;
+    }
+    connectCnt++;
+    client.fetchStates(); // changes missed while disconnected are queued for item listeners like pushed ones
+    client.setPushConnected(true);
+    bConnected = true;
+
+    string line, data, itemName, state;
+    while ( !bStop && std::getline(is, line) ) {
+      if ( !line.empty() && line.back() == '\r' ) {
+        line.pop_back();
+      }
+      if ( line.empty() ) { // end of event
+        if ( !data.empty() && parseEvent(data, topicPrefix, itemName, state) ) {
+          client.pushState(itemName, state);
+        }
+        data.clear();
+      } else if ( line.compare(0, 5, "data:") == 0 ) {
+        if ( !data.empty() ) {
+          data += '\n';
+        }
+        data += line.substr(line.size() > 5 && line[5] == ' ' ? 6 : 5);
+      } // event, id, retry and comment lines are not needed
+    }
+  } catch (Poco::Exception &ex) {
+    if ( !bStop ) {
+      cerr << __PRETTY_FUNCTION__ << " ERROR: " << ex.displayText() << endl;
+    }
+  }
+  bConnected = false;
+  client.setPushConnected(false);
+  session.reset();
+}
+
+// {"topic":"smarthome/items/Hvac_Switch/statechanged","payload":"{\"type\":\"OnOff\",\"value\":\"ON\",...}","type":"ItemStateChangedEvent"}
+bool OpenHabEventStream::parseEvent(const string& data, const string& topicPrefix, string& itemName, string& state) {
+  static const string SUFFIX = "/statechanged";
+  try {
+    Poco::JSON::Parser parser;
+    Poco::JSON::Object::Ptr pEvent = parser.parse(data).extract<Poco::JSON::Object::Ptr>();
+    string topic = pEvent->optValue<string>("topic", "");
+    string prefix = topicPrefix + "/";
+    if ( topic.size() <= prefix.size() + SUFFIX.size() || topic.compare(0, prefix.size(), prefix) != 0
+         || topic.compare(topic.size() - SUFFIX.size(), SUFFIX.size(), SUFFIX) != 0 ) {
+      return false;
+    }
+    parser.reset();
+    Poco::JSON::Object::Ptr pPayload = parser.parse(pEvent->getValue<string>("payload")).extract<Poco::JSON::Object::Ptr>();
+    itemName = topic.substr(prefix.size(), topic.size() - prefix.size() - SUFFIX.size());
+    state = pPayload->getValue<string>("value");
+    return true;
+  } catch (Poco::Exception &ex) {
+    cerr << __PRETTY_FUNCTION__ << " ERROR: Failed parsing event: " << ex.displayText() << " [" << data << "]" << endl;
+    return false;
+  }
+}
+
+}
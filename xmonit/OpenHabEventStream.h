@@ -0,0 +1,58 @@
+#ifndef XMONIT_OPENHABEVENTSTREAM_H
+#define XMONIT_OPENHABEVENTSTREAM_H
+
+#include "OpenHabClient.h"
+#include "DnsCache.h"
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+namespace xmonit {
+
+  // Subscribes to OpenHAB's server sent events (/rest/events) for state changes of the items tracked by the
+  // client and pushes them into the client as they arrive.  States are fetched once after each connect so changes
+  // missed while disconnected reach item listeners too.  Reconnects with exponential backoff and the client goes back to
+  // polling until connected again.
+  class OpenHabEventStream {
+  public:
+
+    string topicPrefix;                 // openhab 2 "smarthome/items", openhab 3+ "openhab/items"
+    unsigned long minBackoffMs = 1000;
+    unsigned long maxBackoffMs = 60000;
+
+    OpenHabEventStream(OpenHabClient& client, const string& host = "openhab", unsigned short port = 8080,
+                       const string& topicPrefix = "smarthome/items");
+
+    ~OpenHabEventStream() {
+      stop();
+    }
+
+    void start();
+    void stop();
+
+    bool isConnected() const { return bConnected; }
+    unsigned long getConnectCount() const { return connectCnt; }
+
+    // item name and new state from the data of a statechanged event, false for other events
+    static bool parseEvent(const string& data, const string& topicPrefix, string& itemName, string& state);
+
+  protected:
+    OpenHabClient& client;
+    CachedDnsSession<> session;
+    std::thread worker;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    std::atomic<bool> bStop {false};
+    std::atomic<bool> bConnected {false};
+    std::atomic<unsigned long> connectCnt {0};
+
+    void run();
+
+    // one connection, returns when the stream ends or fails
+    void stream();
+  };
+}
+#endif
@@ -2,6 +2,8 @@
 #define XMONIT_OPENHABPOWERSWITCH_H
 
 #include "../automation/device/PowerSwitch.h"
+#include "../automation/Cacheable.h"
+#include "OpenHabClient.h"
 #include "xmonit.h"
 
 #include <Poco/DynamicStruct.h>
@@ -30,25 +32,33 @@ using namespace Poco;
 namespace xmonit {
 
 
-  class OpenHabSwitch : public automation::PowerSwitch {
+  // Item state is cached for 30 seconds.  After that isOn() returns the cached state while the item is fetched in
+  // the background.  After 5 minutes without a successful fetch the switch reports an error.  Requests go through
+  // the shared OpenHabClient which fetches the states of all switches together.  Changes pushed by the OpenHAB event
+  // stream replace the cached state right away.
+  class OpenHabSwitch : public automation::PowerSwitch, public automation::AsyncCacheable<float>, public OpenHabClient::ItemListener {
   public:
     RTTI_GET_TYPE_IMPL(xmonit,OpenHabPowerSwitch);
 
     string itemName;
-    mutable  HTTPClientSession clientSession;
     string openHabItemUrl;
     
     OpenHabSwitch(const string &title, const string &itemName, float requiredWatts = 0) : 
       automation::PowerSwitch(title,requiredWatts), 
+      automation::AsyncCacheable<float>(30*SECONDS, 5*MINUTES, NAN),
       itemName(itemName),
-      clientSession("openhab",8080),
       bLastIsOnCheckResult(false),
-      lastIsOnCachedResultTimeMs(0)
+      lastLoadCnt(0)
      {
       openHabItemUrl = "/rest/items/";
       openHabItemUrl += itemName;
+      OpenHabClient::instance.track(itemName, this);
      }
 
+    ~OpenHabSwitch() {
+      joinRefresh();
+    }
+
     void setup() override {
       Constraint* pConstraint = getConstraint();
       if ( pConstraint ) {
@@ -73,37 +83,48 @@ namespace xmonit {
     }
 
     bool isOn() const override {
-      ulong nowMs = automation::millisecs();
-      if ( nowMs - lastIsOnCachedResultTimeMs > 30000 ) {
-        lastIsOnCachedResultTimeMs = nowMs;
-        Poco::JSON::Object::Ptr pJsonResp = processRequest(HTTPRequest::HTTP_GET,"");
-        Poco::Dynamic::Var itemState = pJsonResp->get("state");
-        if ( itemState.isEmpty() ) {
-          bError = true;
-          automation::logBuffer << __PRETTY_FUNCTION__ << " ERROR" << endl;
-        } else {
-          bError = false;
-          bool bOnFromOpenHab = itemState == "ON";
-          
-          /* open hab or the actual power switch on the device may have changed on/off status so treat that like a remote set command */
-          Constraint* pConstraint = getConstraint();
-          if ( pConstraint && pConstraint->isPassed() != bOnFromOpenHab  ) {            
-            pConstraint->overrideTestResult(bOnFromOpenHab);
-            pConstraint->pRemoteExpiredOp->reset();
-            automation::logBuffer << __PRETTY_FUNCTION__ << "=" << bOnFromOpenHab << " '" << this->getTitle() << "' change from openhab so updated contraint (openhab state: " 
-              << itemState.toString() << ")" << endl;
-          }
-          
-          bLastIsOnCheckResult = bOnFromOpenHab;
-          lastIsOnCachedResultTimeMs = automation::millisecs();
-          //automation::logBuffer << __PRETTY_FUNCTION__ << " result:" << bLastIsOnCheckResult << endl;
-        } 
+      float itemState = getCachedValue();
+      if ( isnan(itemState) ) {
+        bError = true; // failed fetch or no state for too long
+        return bLastIsOnCheckResult;
+      }
+      bError = false;
+      unsigned long loadCnt = getLoadCount();
+      if ( loadCnt != lastLoadCnt ) {
+        lastLoadCnt = loadCnt;
+        bool bOnFromOpenHab = itemState != 0;
+        acknowledge(bOnFromOpenHab); // commands matching the item state are not sent again
+
+        /* open hab or the actual power switch on the device may have changed on/off status so treat that like a remote set command */
+        Constraint* pConstraint = getConstraint();
+        if ( pConstraint && pConstraint->isPassed() != bOnFromOpenHab  ) {            
+          pConstraint->overrideTestResult(bOnFromOpenHab);
+          pConstraint->pRemoteExpiredOp->reset();
+          automation::logBuffer << __PRETTY_FUNCTION__ << "=" << bOnFromOpenHab << " '" << this->getTitle() << "' change from openhab so updated contraint (openhab state: " 
+            << (bOnFromOpenHab ? "ON" : "OFF") << ")" << endl;
+        }
       }
+      bLastIsOnCheckResult = itemState != 0;
       return bLastIsOnCheckResult;
     }
 
+    // pushed change (dispatched on the main loop thread) so apply it like a fresh fetch
+    void itemStateChanged(const string& changedItemName, float state) override {
+      setLoadedValue(state);
+      isOn();
+    }
+
+    // item state (1 for ON, 0 for OFF) from the shared bulk fetch.  Runs on the cache refresh thread.
+    bool loadValue(float& state) const override {
+      state = OpenHabClient::instance.getState(itemName);
+      return !isnan(state);
+    }
+
     void setOn(bool bOn) override {
-      Poco::JSON::Object::Ptr pJsonResp = processRequest(HTTPRequest::HTTP_POST,bOn?"ON":"OFF","text/plain");
+      ActuatorMetrics::Call call(name);
+      ActuatorMetrics::Result result = ActuatorMetrics::Result::Error;
+      Poco::JSON::Object::Ptr pJsonResp = OpenHabClient::instance.processRequest(HTTPRequest::HTTP_POST,openHabItemUrl,bOn?"ON":"OFF","text/plain",&result);
+      call.done(result);
       Poco::Dynamic::Var statusVar = pJsonResp->get("status");
       if ( statusVar.isEmpty() || statusVar.convert<int>() != HTTPResponse::HTTP_OK ) {
         bError = true;
@@ -120,7 +141,7 @@ namespace xmonit {
 	      bError = false;
         automation::logBuffer << __PRETTY_FUNCTION__ << " '" << this->getTitle() << "' bOn=" << bOn << endl;
         bLastIsOnCheckResult = bOn;
-        lastIsOnCachedResultTimeMs = automation::millisecs();
+        setCachedValue(bOn);
         Constraint* pConstraint = getConstraint();
         if ( pConstraint ) {
           pConstraint->overrideTestResult(bOn);
@@ -130,54 +151,7 @@ namespace xmonit {
 
     protected:
     mutable bool bLastIsOnCheckResult;
-    mutable ulong lastIsOnCachedResultTimeMs;
-
-
-    Poco::JSON::Object::Ptr processRequest(const string& httpMethod, const string& httpBody, const string contentType = "application/json") const {
-      string httpHeaderLine1;
-      Poco::JSON::Object::Ptr resultPtr; 
-      try{
-        HTTPRequest req(httpMethod, openHabItemUrl);
-        req.setContentType(contentType);
-        req.setContentLength(httpBody.length());
-
-        //automation::logBuffer << ">>>>> BEGIN OpenHab Request @ " << DateTimeFormatter::format(LocalDateTime(), DateTimeFormat::SORTABLE_FORMAT) << " <<<<<" << endl;
-        stringstream ss;
-        req.write(ss);
-        getline(ss,httpHeaderLine1);
-        httpHeaderLine1 = Poco::replace(httpHeaderLine1,'\r');
-        //automation::logBuffer << requestLine1 << endl;
-
-        ostream &os = clientSession.sendRequest(req);
-        os << httpBody;
-
-        HTTPResponse resp;
-        istream &is = clientSession.receiveResponse(resp);
-        if ( contentType == "application/json" ) {
-          Poco::JSON::Parser parser;
-          Poco::Dynamic::Var result = parser.parse(is);
-          resultPtr = result.extract<Poco::JSON::Object::Ptr>();
-        } else {
-          resultPtr = new Poco::JSON::Object;
-          Poco::Dynamic::Var status = (int) resp.getStatus();
-          resultPtr->set("status", status);
-          resultPtr->set("reason", resp.getReason());
-        }
-      }
-      catch (Poco::Exception &ex)
-      {
-        cerr << __PRETTY_FUNCTION__ << " ERROR: Failed HTTP request: " <<  httpHeaderLine1 << endl;
-        cerr << ex.displayText() << endl;
-        resultPtr = new Poco::JSON::Object;
-        resultPtr->set("status", 500);
-        resultPtr->set("reason", ex.displayText() );
-      }
-      //resultPtr->stringify(automation::logBuffer);
-      //automation::logBuffer << endl;
-      //automation::logBuffer << ">>>>> END OpenHab Request<<<<<" << endl;
-
-      return resultPtr;
-    }
+    mutable unsigned long lastLoadCnt;
 
   };
 }
@@ -4,6 +4,7 @@
 #include "../automation/device/PowerSwitch.h"
 #include "xmonit.h"
 #include "XmonitSession.h"
+#include "ActuatorMetrics.h"
 
 
 namespace xmonit {
@@ -42,14 +43,17 @@ namespace xmonit {
     void setOn(bool bOn) override {
       bError = false;
       string eventLabel = bOn ? strOnEventLabel : strOffEventLabel;
-      auto pSession = std::make_unique<XmonitSession>();
+      XmonitSession session;
 
       for( int i = 0; i < MAX_RETRY_CNT; i++) {
+        ActuatorMetrics::Call call(name);
         try {
-          pSession->sendToggleEvent(name,bOn);
+          bool bOk = session.sendToggleEvent(name,bOn);
+          call.done(bOk ? ActuatorMetrics::Result::Ok : ActuatorMetrics::Result::HttpError);
           return;
         } catch (Poco::Exception &ex)  {
-          automation::logBuffer << "FAILED turning " << ( bOn ? "ON" : "OFF" ) << " switch '" << name << "' (XMONIT host: " << pSession->getHost() << ")." << endl;
+          call.done(ex);
+          automation::logBuffer << "FAILED turning " << ( bOn ? "ON" : "OFF" ) << " switch '" << name << "' (XMONIT host: " << session.getHost() << ")." << endl;
           automation::logBuffer << ex.displayText() << endl;
         }
       }
@@ -4,6 +4,7 @@
 #include "xmonit.h"
 #include "XmonitRequest.h"
 #include "../automation/Automation.h"
+#include "HttpClientPool.h"
 #include <Poco/Net/HTTPSClientSession.h>
 #include <Poco/Net/HTTPRequest.h>
 #include <Poco/Net/HTTPResponse.h>
@@ -24,17 +25,20 @@ using namespace std;
 namespace xmonit {
 
   //////////////////////////////////////////////////////////////////////////
-  // Handles sending requests to the Java Spring Web App that controls Arduinos and Charge Controllers
-  class XmonitSession : public HTTPClientSession {
+  // Handles sending requests to the Java Spring Web App that controls Arduinos and Charge Controllers.  Connections
+  // come from HttpClientPool so they are kept open between requests.
+  class XmonitSession {
 
   public:
 
-    XmonitSession() :
-        HTTPClientSession("solar",9202) {
-      setKeepAlive(true);
+    XmonitSession(const string& host = "solar", unsigned short port = 9202) :
+        host(host),
+        port(port) {
     }
 
-    
+    const string& getHost() const {
+      return host;
+    }
 
     bool sendToggleEvent(string& deviceFilterName, bool bOn) {
       return sendRequest(ToggleRequest(bOn, deviceFilterName));
@@ -67,16 +71,22 @@ namespace xmonit {
       getline(rawRequestStream,requestLine1);
       requestLine1.erase(remove(requestLine1.begin(), requestLine1.end(), '\r'), requestLine1.end());
       automation::logBuffer << "HTTP Request (line 1): " << requestLine1 << endl;
-      ostream &os = HTTPClientSession::sendRequest(httpRequest);
+      HttpClientPool::Lease pSession = HttpClientPool::instance.acquire(host, port);
+      ostream &os = pSession->sendRequest(httpRequest);
       os << reqBody;
       HTTPResponse resp;
-      istream &is = receiveResponse(resp);
+      istream &is = pSession->receiveResponse(resp);
       string strResp;
       Poco::StreamCopier::copyToString(is, strResp);
+      pSession.done();
       automation::logBuffer << "response: " << strResp << endl;
       automation::logBuffer << ">>>>> END XMonit Service Request" << "<<<<<" << endl;
       return resp.getStatus() == HTTPResponse::HTTPStatus::HTTP_OK;
     }
+
+  protected:
+    string host;
+    unsigned short port;
   };
 };
 #endif
\ No newline at end of file